@@ -0,0 +1,315 @@
+#include "headers/blockdevice.h"
+
+#ifdef Q_OS_LINUX
+
+#include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+
+namespace {
+const qint64 DefaultSectorSize = 512;
+const qint64 DefaultScanReadUnit = 4 * 1024 * 1024;
+
+char *allocateAligned(qint64 alignment, qint64 length)
+{
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, static_cast<size_t>(alignment), static_cast<size_t>(length)) != 0) {
+        return nullptr;
+    }
+    return static_cast<char *>(buffer);
+}
+}
+
+BlockDevice::BlockDevice(const QString &devicePath, QObject *parent)
+    : QIODevice(parent),
+    m_devicePath(devicePath),
+    m_fd(-1),
+    m_directIo(false),
+    m_size(0),
+    m_sectorSize(DefaultSectorSize),
+    m_scanReadUnit(DefaultScanReadUnit),
+    m_viewBuffer(nullptr),
+    m_viewStart(0),
+    m_viewLength(0)
+{
+}
+
+BlockDevice::~BlockDevice()
+{
+    close();
+}
+
+bool BlockDevice::open(OpenMode mode)
+{
+    if (mode & QIODevice::WriteOnly) {
+        qDebug() << "Block devices can only be opened for reading.";
+        return false;
+    }
+
+    const QByteArray path = QFile::encodeName(m_devicePath);
+
+    // Not every file system supports O_DIRECT (tmpfs, some FUSE mounts)
+    m_fd = ::open(path.constData(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+    m_directIo = m_fd >= 0;
+    if (m_fd < 0 && errno == EINVAL) {
+        m_fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    }
+    if (m_fd < 0) {
+        qCritical() << "Failed to open block device" << m_devicePath << ":" << strerror(errno);
+        return false;
+    }
+
+    struct stat deviceStat;
+    if (fstat(m_fd, &deviceStat) != 0) {
+        qCritical() << "Failed to stat block device" << m_devicePath;
+        close();
+        return false;
+    }
+
+    if (S_ISBLK(deviceStat.st_mode)) {
+        quint64 deviceSize = 0;
+        int logicalSectorSize = 0;
+        if (ioctl(m_fd, BLKGETSIZE64, &deviceSize) != 0) {
+            qCritical() << "Failed to get size of block device" << m_devicePath;
+            close();
+            return false;
+        }
+        m_size = static_cast<qint64>(deviceSize);
+        if (ioctl(m_fd, BLKSSZGET, &logicalSectorSize) == 0 && logicalSectorSize > 0) {
+            m_sectorSize = logicalSectorSize;
+        }
+    } else {
+        // Plain files: O_DIRECT alignment follows the file system block size
+        m_size = deviceStat.st_size;
+        m_sectorSize = qMax<qint64>(DefaultSectorSize, deviceStat.st_blksize);
+    }
+
+    m_viewBuffer = allocateAligned(m_sectorSize, ViewReadUnit);
+    if (!m_viewBuffer) {
+        qCritical() << "Failed to allocate aligned view buffer";
+        close();
+        return false;
+    }
+    m_viewLength = 0;
+    setScanReadUnit(m_scanReadUnit);
+
+    qDebug() << "Opened block device" << m_devicePath << "size" << m_size << "sector size" << m_sectorSize << "direct I/O" << m_directIo;
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void BlockDevice::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    free(m_viewBuffer);
+    m_viewBuffer = nullptr;
+    m_viewLength = 0;
+    QIODevice::close();
+}
+
+qint64 BlockDevice::size() const
+{
+    return m_size;
+}
+
+qint64 BlockDevice::mediaSize() const
+{
+    return m_size;
+}
+
+qint64 BlockDevice::sectorSize() const
+{
+    return m_sectorSize;
+}
+
+bool BlockDevice::isDirectIo() const
+{
+    return m_directIo;
+}
+
+void BlockDevice::setScanReadUnit(qint64 bytes)
+{
+    qint64 unit = qBound(MinScanReadUnit, bytes, MaxScanReadUnit);
+    m_scanReadUnit = qMax(m_sectorSize, (unit / m_sectorSize) * m_sectorSize);
+}
+
+qint64 BlockDevice::scanReadUnit() const
+{
+    return m_scanReadUnit;
+}
+
+// Some file systems accept O_DIRECT at open() and reject the reads with EINVAL
+bool BlockDevice::reopenBuffered()
+{
+    QMutexLocker locker(&m_reopenMutex);
+    if (!m_directIo) {
+        return true;
+    }
+
+    int flags = fcntl(m_fd, F_GETFL);
+    if (flags == -1 || fcntl(m_fd, F_SETFL, flags & ~O_DIRECT) == -1) {
+        qCritical() << "Failed to disable direct I/O on" << m_devicePath;
+        return false;
+    }
+
+    qDebug() << "Direct I/O rejected, falling back to buffered reads for" << m_devicePath;
+    m_directIo = false;
+    return true;
+}
+
+// Offset, buffer and length must all be sector aligned
+qint64 BlockDevice::readAligned(qint64 alignedOffset, char *alignedBuffer, qint64 alignedLength)
+{
+    qint64 bytesRead = 0;
+    while (bytesRead < alignedLength) {
+        ssize_t count = pread(m_fd, alignedBuffer + bytesRead, static_cast<size_t>(alignedLength - bytesRead), static_cast<off_t>(alignedOffset + bytesRead));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EINVAL && m_directIo && reopenBuffered()) {
+                continue;
+            }
+            qCritical() << "Failed to read block device at" << alignedOffset + bytesRead << ":" << strerror(errno);
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+        if (count == 0) {
+            break; // End of the device
+        }
+        bytesRead += count;
+    }
+    return bytesRead;
+}
+
+qint64 BlockDevice::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0 || m_fd < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= m_size) {
+        return 0;
+    }
+
+    maxlen = qMin(maxlen, m_size - offset);
+    IoStatistics::ReadTimer timer(m_statistics);
+
+    // Small reads come from the hex view and are usually repeated or adjacent
+    if (maxlen <= ViewReadUnit / 2) {
+        return timer.finish(readThroughViewUnit(offset, data, maxlen));
+    }
+    return timer.finish(readUnbuffered(offset, data, maxlen, m_scanReadUnit));
+}
+
+qint64 BlockDevice::readThroughViewUnit(qint64 offset, char *data, qint64 maxlen)
+{
+    QMutexLocker locker(&m_viewMutex);
+
+    if (offset < m_viewStart || offset + maxlen > m_viewStart + m_viewLength) {
+        const qint64 unitStart = (offset / m_sectorSize) * m_sectorSize;
+        if (offset + maxlen > unitStart + ViewReadUnit) {
+            locker.unlock();
+            return readUnbuffered(offset, data, maxlen, ViewReadUnit);
+        }
+
+        m_viewLength = 0;
+        const qint64 unitRead = readAligned(unitStart, m_viewBuffer, ViewReadUnit);
+        if (unitRead <= 0) {
+            return -1;
+        }
+        m_viewStart = unitStart;
+        m_viewLength = unitRead;
+    }
+
+    const qint64 available = qMin(maxlen, m_viewStart + m_viewLength - offset);
+    if (available <= 0) {
+        return 0;
+    }
+    memcpy(data, m_viewBuffer + (offset - m_viewStart), available);
+    return available;
+}
+
+qint64 BlockDevice::tryReadAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+
+    QMutexLocker locker(&m_viewMutex);
+    if (offset < m_viewStart || offset + maxlen > m_viewStart + m_viewLength) {
+        return -1;
+    }
+    memcpy(data, m_viewBuffer + (offset - m_viewStart), maxlen);
+    return maxlen;
+}
+
+qint64 BlockDevice::readUnbuffered(qint64 offset, char *data, qint64 maxlen, qint64 unit)
+{
+    const qint64 alignedStart = (offset / m_sectorSize) * m_sectorSize;
+    const qint64 alignedEnd = ((offset + maxlen + m_sectorSize - 1) / m_sectorSize) * m_sectorSize;
+
+    // Aligned caller buffers are filled in place without a bounce copy
+    const bool direct = alignedStart == offset && alignedEnd == offset + maxlen
+                        && reinterpret_cast<quintptr>(data) % m_sectorSize == 0;
+    if (direct) {
+        return readAligned(offset, data, maxlen);
+    }
+
+    const qint64 bounceLength = qMin(unit, alignedEnd - alignedStart);
+    char *bounce = allocateAligned(m_sectorSize, bounceLength);
+    if (!bounce) {
+        qCritical() << "Failed to allocate aligned read buffer of" << bounceLength << "bytes";
+        return -1;
+    }
+
+    qint64 bytesRead = 0;
+    qint64 position = alignedStart;
+    while (position < alignedEnd && bytesRead < maxlen) {
+        const qint64 length = qMin(bounceLength, alignedEnd - position);
+        const qint64 count = readAligned(position, bounce, length);
+        if (count <= 0) {
+            break;
+        }
+
+        // The first unit may start before the requested offset
+        const qint64 skip = qMax<qint64>(0, offset + bytesRead - position);
+        const qint64 toCopy = qMin(count - skip, maxlen - bytesRead);
+        if (toCopy <= 0) {
+            break;
+        }
+        memcpy(data + bytesRead, bounce + skip, toCopy);
+        bytesRead += toCopy;
+        position += count;
+
+        if (count < length) {
+            break; // Short read at the end of the device
+        }
+    }
+
+    free(bounce);
+    return bytesRead > 0 ? bytesRead : -1;
+}
+
+qint64 BlockDevice::readData(char *data, qint64 maxlen)
+{
+    return readAt(QIODevice::pos(), data, maxlen);
+}
+
+qint64 BlockDevice::writeData(const char *data, qint64 len)
+{
+    // Writing is not supported for this device.
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
+
+#endif // Q_OS_LINUX
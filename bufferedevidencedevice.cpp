@@ -0,0 +1,339 @@
+#include "headers/bufferedevidencedevice.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <cstring>
+#include <mutex>
+
+BufferedEvidenceDevice::Policy BufferedEvidenceDevice::Policy::interactive(qint64 alignment)
+{
+    Policy policy;
+    policy.blockSize = 4096;
+    policy.alignment = alignment;
+    policy.slotCount = 64;
+    policy.readAhead = false;
+    return policy;
+}
+
+BufferedEvidenceDevice::Policy BufferedEvidenceDevice::Policy::streaming(qint64 alignment)
+{
+    Policy policy;
+    policy.blockSize = 4 * 1024 * 1024;
+    policy.alignment = alignment;
+    policy.slotCount = 2;
+    policy.readAhead = true;
+    return policy;
+}
+
+// Power of two alignment, blocks a multiple of it, and room for the block ahead
+BufferedEvidenceDevice::Policy BufferedEvidenceDevice::normalized(Policy policy)
+{
+    qint64 alignment = 1;
+    while (alignment < policy.alignment) {
+        alignment <<= 1;
+    }
+    policy.alignment = alignment;
+    policy.blockSize = qMax(alignment, ((policy.blockSize + alignment - 1) / alignment) * alignment);
+    policy.slotCount = qMax(policy.readAhead ? 2 : 1, policy.slotCount);
+    return policy;
+}
+
+BufferedEvidenceDevice::BufferedEvidenceDevice(QIODevice *backend, const Policy &policy, QObject *parent)
+    : QIODevice(parent),
+    m_backend(backend),
+    m_source(dynamic_cast<EvidenceSource *>(backend)),
+    m_size(backend->size()),
+    m_policy(normalized(policy)),
+    m_slots(m_policy.slotCount),
+    m_useCounter(0)
+{
+    m_backend->setParent(this);
+    m_readAheadPool.setMaxThreadCount(1);
+}
+
+BufferedEvidenceDevice::BufferedEvidenceDevice(EvidenceSource *source, const Policy &policy, QObject *parent)
+    : QIODevice(parent),
+    m_backend(nullptr),
+    m_source(source),
+    m_size(source->mediaSize()),
+    m_policy(normalized(policy)),
+    m_slots(m_policy.slotCount),
+    m_useCounter(0)
+{
+    m_readAheadPool.setMaxThreadCount(1);
+}
+
+BufferedEvidenceDevice::~BufferedEvidenceDevice()
+{
+    // A block still being read ahead uses the backend
+    m_readAheadPool.clear();
+    m_readAheadPool.waitForDone();
+    QIODevice::close();
+}
+
+qint64 BufferedEvidenceDevice::size() const
+{
+    return m_size;
+}
+
+qint64 BufferedEvidenceDevice::mediaSize() const
+{
+    return m_size;
+}
+
+BufferedEvidenceDevice::Policy BufferedEvidenceDevice::policy() const
+{
+    return m_policy;
+}
+
+// Blocks still loading are left to their reader, which fills them afterwards
+void BufferedEvidenceDevice::clearBuffer()
+{
+    QMutexLocker locker(&m_mutex);
+    for (Slot &slot : m_slots) {
+        if (!slot.loading) {
+            slot.start = -1;
+            slot.data.clear();
+        }
+    }
+}
+
+EvidenceSource *BufferedEvidenceDevice::innerSource() const
+{
+    return m_source;
+}
+
+qint64 BufferedEvidenceDevice::readBackend(qint64 offset, char *data, qint64 length)
+{
+    if (m_source) {
+        qint64 bytesRead = 0;
+        while (bytesRead < length) {
+            const qint64 count = m_policy.uncached
+                ? m_source->readUncached(offset + bytesRead, data + bytesRead, length - bytesRead)
+                : m_source->readAt(offset + bytesRead, data + bytesRead, length - bytesRead);
+            if (count <= 0) {
+                break;
+            }
+            bytesRead += count;
+        }
+        return bytesRead > 0 ? bytesRead : -1;
+    }
+
+    QMutexLocker locker(&m_backendMutex);
+    if (!m_backend->seek(offset)) {
+        return -1;
+    }
+    return m_backend->read(data, length);
+}
+
+QByteArray BufferedEvidenceDevice::readBlock(qint64 blockStart)
+{
+    const qint64 length = qMin(m_policy.blockSize, m_size - blockStart);
+    QByteArray data(length, Qt::Uninitialized);
+    const qint64 bytesRead = readBackend(blockStart, data.data(), length);
+    if (bytesRead <= 0) {
+        qDebug() << "Buffered device: failed to read block at" << blockStart;
+        return QByteArray();
+    }
+    data.resize(bytesRead);
+    return data;
+}
+
+// Caller must hold m_mutex. Takes the least recently used slot that is not being
+// filled, or returns -1 when every slot is busy.
+int BufferedEvidenceDevice::claimSlot(qint64 blockStart)
+{
+    int victim = -1;
+    for (int i = 0; i < m_slots.size(); ++i) {
+        if (!m_slots.at(i).loading && (victim < 0 || m_slots.at(i).lastUse < m_slots.at(victim).lastUse)) {
+            victim = i;
+        }
+    }
+    if (victim >= 0) {
+        Slot &slot = m_slots[victim];
+        slot.start = blockStart;
+        slot.data = QByteArray();
+        slot.loading = true;
+    }
+    return victim;
+}
+
+void BufferedEvidenceDevice::finishSlot(int slot, const QByteArray &data)
+{
+    QMutexLocker locker(&m_mutex);
+    Slot &entry = m_slots[slot];
+    entry.loading = false;
+    entry.data = data;
+    entry.lastUse = ++m_useCounter;
+    if (data.isEmpty()) {
+        entry.start = -1;
+    }
+    m_slotLoaded.wakeAll();
+}
+
+QByteArray BufferedEvidenceDevice::block(qint64 blockStart)
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (;;) {
+        int found = -1;
+        for (int i = 0; i < m_slots.size(); ++i) {
+            if (m_slots.at(i).start == blockStart) {
+                found = i;
+                break;
+            }
+        }
+        if (found < 0) {
+            break;
+        }
+        if (m_slots.at(found).loading) {
+            // Usually the block the read-ahead is still working on
+            m_slotLoaded.wait(&m_mutex);
+            continue;
+        }
+
+        m_slots[found].lastUse = ++m_useCounter;
+        const QByteArray data = m_slots.at(found).data;
+        locker.unlock();
+        m_statistics.recordCacheHit();
+        if (m_policy.readAhead) {
+            scheduleReadAhead(blockStart + m_policy.blockSize);
+        }
+        return data;
+    }
+
+    const int slot = claimSlot(blockStart);
+    locker.unlock();
+    m_statistics.recordCacheMiss();
+
+    const QByteArray data = readBlock(blockStart);
+    if (slot >= 0) {
+        finishSlot(slot, data);
+    }
+    if (m_policy.readAhead && !data.isEmpty()) {
+        scheduleReadAhead(blockStart + m_policy.blockSize);
+    }
+    return data;
+}
+
+void BufferedEvidenceDevice::scheduleReadAhead(qint64 blockStart)
+{
+    if (blockStart >= m_size) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (const Slot &slot : m_slots) {
+        if (slot.start == blockStart) {
+            return;
+        }
+    }
+    const int slot = claimSlot(blockStart);
+    if (slot < 0) {
+        return;
+    }
+    locker.unlock();
+
+    m_statistics.beginAsync();
+    m_readAheadPool.start([this, slot, blockStart]() {
+        finishSlot(slot, readBlock(blockStart));
+        m_statistics.endAsync();
+    });
+}
+
+qint64 BufferedEvidenceDevice::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= m_size) {
+        return 0;
+    }
+
+    IoStatistics::ReadTimer timer(m_statistics);
+    const qint64 bytesToRead = qMin(maxlen, m_size - offset);
+    qint64 bytesRead = 0;
+    while (bytesRead < bytesToRead) {
+        const qint64 position = offset + bytesRead;
+        const qint64 remaining = bytesToRead - bytesRead;
+
+        // Without read-ahead, aligned reads of a block or more skip the slots
+        if (!m_policy.readAhead && position % m_policy.alignment == 0 && remaining >= m_policy.blockSize) {
+            const qint64 length = (remaining / m_policy.alignment) * m_policy.alignment;
+            const qint64 count = readBackend(position, data + bytesRead, length);
+            if (count <= 0) {
+                break;
+            }
+            bytesRead += count;
+            if (count < length) {
+                break;
+            }
+            continue;
+        }
+
+        const qint64 blockStart = position - position % m_policy.blockSize;
+        const QByteArray blockData = block(blockStart);
+        const qint64 blockOffset = position - blockStart;
+        if (blockOffset >= blockData.size()) {
+            break;
+        }
+
+        const qint64 bytesToCopy = qMin(remaining, static_cast<qint64>(blockData.size()) - blockOffset);
+        memcpy(data + bytesRead, blockData.constData() + blockOffset, bytesToCopy);
+        bytesRead += bytesToCopy;
+    }
+
+    return timer.finish(bytesRead > 0 ? bytesRead : -1);
+}
+
+// Served only from filled slots and never waits for the backend
+qint64 BufferedEvidenceDevice::tryReadAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= m_size) {
+        return 0;
+    }
+
+    std::unique_lock<QMutex> locker(m_mutex, std::try_to_lock);
+    if (!locker.owns_lock()) {
+        return -1;
+    }
+
+    const qint64 bytesToRead = qMin(maxlen, m_size - offset);
+    qint64 bytesRead = 0;
+    while (bytesRead < bytesToRead) {
+        const qint64 position = offset + bytesRead;
+        const qint64 blockStart = position - position % m_policy.blockSize;
+        const Slot *found = nullptr;
+        for (const Slot &slot : m_slots) {
+            if (slot.start == blockStart && !slot.loading) {
+                found = &slot;
+                break;
+            }
+        }
+        const qint64 blockOffset = position - blockStart;
+        if (!found || blockOffset >= found->data.size()) {
+            return -1;
+        }
+
+        const qint64 bytesToCopy = qMin(bytesToRead - bytesRead, static_cast<qint64>(found->data.size()) - blockOffset);
+        memcpy(data + bytesRead, found->data.constData() + blockOffset, bytesToCopy);
+        bytesRead += bytesToCopy;
+    }
+
+    return bytesRead;
+}
+
+qint64 BufferedEvidenceDevice::readData(char *data, qint64 maxlen)
+{
+    return readAt(QIODevice::pos(), data, maxlen);
+}
+
+qint64 BufferedEvidenceDevice::writeData(const char *data, qint64 len)
+{
+    // Writing is not supported for this device.
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
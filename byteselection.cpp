@@ -0,0 +1,73 @@
+#include "headers/byteselection.h"
+#include <algorithm>
+
+void ByteSelection::clear()
+{
+    m_ranges.clear();
+}
+
+bool ByteSelection::isEmpty() const
+{
+    return m_ranges.isEmpty();
+}
+
+void ByteSelection::addRange(quint64 first, quint64 last)
+{
+    Range added{qMin(first, last), qMax(first, last)};
+
+    // Ranges ending right before the new one are merged too, so the set stays minimal
+    int index = firstEndingAtOrAfter(added.start > 0 ? added.start - 1 : 0);
+    while (index < m_ranges.size() && (added.end == ~quint64(0) || m_ranges.at(index).start <= added.end + 1)) {
+        added.start = qMin(added.start, m_ranges.at(index).start);
+        added.end = qMax(added.end, m_ranges.at(index).end);
+        m_ranges.remove(index);
+    }
+    m_ranges.insert(index, added);
+}
+
+bool ByteSelection::contains(quint64 offset) const
+{
+    const int index = firstEndingAtOrAfter(offset);
+    return index < m_ranges.size() && m_ranges.at(index).start <= offset;
+}
+
+QVector<ByteSelection::Range> ByteSelection::rangesIn(quint64 from, quint64 to) const
+{
+    QVector<Range> result;
+    for (int index = firstEndingAtOrAfter(from); index < m_ranges.size() && m_ranges.at(index).start < to; ++index) {
+        result.append(m_ranges.at(index));
+    }
+    return result;
+}
+
+const QVector<ByteSelection::Range> &ByteSelection::ranges() const
+{
+    return m_ranges;
+}
+
+quint64 ByteSelection::totalLength() const
+{
+    quint64 length = 0;
+    for (const Range &range : m_ranges) {
+        length += range.end - range.start + 1;
+    }
+    return length;
+}
+
+quint64 ByteSelection::firstOffset() const
+{
+    return m_ranges.isEmpty() ? 0 : m_ranges.first().start;
+}
+
+quint64 ByteSelection::lastOffset() const
+{
+    return m_ranges.isEmpty() ? 0 : m_ranges.last().end;
+}
+
+// Binary search, the ranges are sorted and disjoint so their ends are sorted as well
+int ByteSelection::firstEndingAtOrAfter(quint64 offset) const
+{
+    const auto it = std::lower_bound(m_ranges.constBegin(), m_ranges.constEnd(), offset,
+                                     [](const Range &range, quint64 value) { return range.end < value; });
+    return it - m_ranges.constBegin();
+}
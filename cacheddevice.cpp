@@ -0,0 +1,243 @@
+#include "headers/cacheddevice.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <cstring>
+#include <mutex>
+
+CachedDevice::CachedDevice(QIODevice *backend, qint64 pageSize, QObject *parent)
+    : QIODevice(parent),
+    m_backend(backend),
+    m_source(dynamic_cast<EvidenceSource *>(backend)),
+    m_pageSize(pageSize > 0 ? pageSize : DefaultPageSize),
+    m_memoryBudget(0)
+{
+    m_backend->setParent(this);
+    setMemoryBudget(DefaultMemoryBudget);
+}
+
+CachedDevice::~CachedDevice()
+{
+    QIODevice::close();
+}
+
+qint64 CachedDevice::size() const
+{
+    return m_backend->size();
+}
+
+qint64 CachedDevice::mediaSize() const
+{
+    return m_backend->size();
+}
+
+void CachedDevice::setMemoryBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_memoryBudget = qMax(bytes, m_pageSize);
+    m_pages.setMaxCost(static_cast<int>(m_memoryBudget / m_pageSize));
+}
+
+qint64 CachedDevice::memoryBudget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_memoryBudget;
+}
+
+qint64 CachedDevice::pageSize() const
+{
+    return m_pageSize;
+}
+
+void CachedDevice::clearCache()
+{
+    QMutexLocker locker(&m_mutex);
+    m_pages.clear();
+}
+
+QIODevice *CachedDevice::backend() const
+{
+    return m_backend;
+}
+
+EvidenceSource *CachedDevice::innerSource() const
+{
+    return m_source;
+}
+
+QByteArray CachedDevice::cachedPage(qint64 pageIndex) const
+{
+    QMutexLocker locker(&m_mutex);
+    QByteArray *page = m_pages.object(pageIndex);
+    return page ? *page : QByteArray();
+}
+
+void CachedDevice::insertPage(qint64 pageIndex, const QByteArray &page)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pages.insert(pageIndex, new QByteArray(page), 1);
+}
+
+// Positional backends are read without holding m_mutex, so a slow read (for
+// example a prefetch) never blocks readers of pages that are already cached
+QByteArray CachedDevice::loadPage(qint64 pageIndex)
+{
+    const qint64 pageStart = pageIndex * m_pageSize;
+    if (m_source) {
+        QByteArray page = m_source->readBytes(pageStart, qMin(m_pageSize, size() - pageStart));
+        if (page.isEmpty()) {
+            qDebug() << "Page cache: failed to read page at" << pageStart;
+        }
+        return page;
+    }
+
+    // Plain QIODevice backends keep a single seek position
+    QMutexLocker locker(&m_mutex);
+    if (!m_backend->seek(pageStart)) {
+        qDebug() << "Page cache: failed to seek backend to" << pageStart;
+        return QByteArray();
+    }
+
+    const qint64 length = qMin(m_pageSize, size() - pageStart);
+    QByteArray page = m_backend->read(length);
+    if (page.isEmpty()) {
+        qDebug() << "Page cache: failed to read page at" << pageStart;
+    }
+    return page;
+}
+
+qint64 CachedDevice::readData(char *data, qint64 maxlen)
+{
+    return readAt(QIODevice::pos(), data, maxlen);
+}
+
+qint64 CachedDevice::readAt(qint64 pos, char *data, qint64 maxlen)
+{
+    const qint64 totalSize = size();
+
+    if (pos < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || pos >= totalSize) {
+        return 0;
+    }
+
+    IoStatistics::ReadTimer timer(m_statistics);
+    qint64 bytesRead = 0;
+    while (bytesRead < maxlen && pos + bytesRead < totalSize) {
+        const qint64 offset = pos + bytesRead;
+        const qint64 pageIndex = offset / m_pageSize;
+        const qint64 pageOffset = offset % m_pageSize;
+
+        QByteArray page = cachedPage(pageIndex);
+        if (!page.isNull()) {
+            m_statistics.recordCacheHit();
+        } else {
+            m_statistics.recordCacheMiss();
+            page = loadPage(pageIndex);
+            if (page.isEmpty()) {
+                break;
+            }
+            insertPage(pageIndex, page);
+        }
+
+        const qint64 bytesToCopy = qMin(maxlen - bytesRead, static_cast<qint64>(page.size()) - pageOffset);
+        if (bytesToCopy <= 0) {
+            break; // Short page, the backend has no more data
+        }
+
+        memcpy(data + bytesRead, page.constData() + pageOffset, bytesToCopy);
+        bytesRead += bytesToCopy;
+    }
+
+    return timer.finish(bytesRead > 0 ? bytesRead : -1);
+}
+
+// Missing pages of the range are fetched with one large backend read per run
+void CachedDevice::prefetch(qint64 offset, qint64 length)
+{
+    const qint64 end = qMin(offset + length, size());
+    if (offset < 0 || offset >= end) {
+        return;
+    }
+
+    const qint64 firstPage = offset / m_pageSize;
+    const qint64 lastPage = (end - 1) / m_pageSize;
+
+    qint64 runStart = -1;
+    for (qint64 pageIndex = firstPage; pageIndex <= lastPage + 1; ++pageIndex) {
+        const bool missing = pageIndex <= lastPage && cachedPage(pageIndex).isNull();
+        if (missing && runStart < 0) {
+            runStart = pageIndex;
+        } else if (!missing && runStart >= 0) {
+            loadPages(runStart, pageIndex - runStart);
+            runStart = -1;
+        }
+    }
+}
+
+void CachedDevice::loadPages(qint64 firstPage, qint64 count)
+{
+    if (!m_source) {
+        for (qint64 pageIndex = firstPage; pageIndex < firstPage + count; ++pageIndex) {
+            QByteArray page = loadPage(pageIndex);
+            if (page.isEmpty()) {
+                return;
+            }
+            insertPage(pageIndex, page);
+        }
+        return;
+    }
+
+    const qint64 runStart = firstPage * m_pageSize;
+    const QByteArray run = m_source->readBytes(runStart, qMin(count * m_pageSize, size() - runStart));
+    for (qint64 pageOffset = 0; pageOffset < run.size(); pageOffset += m_pageSize) {
+        insertPage(firstPage + pageOffset / m_pageSize, run.mid(pageOffset, m_pageSize));
+    }
+}
+
+// Served only from cached pages and never waits for a backend read in progress
+qint64 CachedDevice::tryReadAt(qint64 offset, char *data, qint64 maxlen)
+{
+    const qint64 totalSize = size();
+
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= totalSize) {
+        return 0;
+    }
+
+    std::unique_lock<QMutex> locker(m_mutex, std::try_to_lock);
+    if (!locker.owns_lock()) {
+        return -1;
+    }
+
+    const qint64 bytesToRead = qMin(maxlen, totalSize - offset);
+    qint64 bytesRead = 0;
+    quint64 pages = 0;
+    while (bytesRead < bytesToRead) {
+        const qint64 position = offset + bytesRead;
+        QByteArray *page = m_pages.object(position / m_pageSize);
+        const qint64 pageOffset = position % m_pageSize;
+        if (!page || pageOffset >= page->size()) {
+            return -1;
+        }
+
+        const qint64 bytesToCopy = qMin(bytesToRead - bytesRead, static_cast<qint64>(page->size()) - pageOffset);
+        memcpy(data + bytesRead, page->constData() + pageOffset, bytesToCopy);
+        bytesRead += bytesToCopy;
+        ++pages;
+    }
+
+    // Only complete hits count, a miss is counted by the readAt() that follows
+    m_statistics.recordCacheHit(pages);
+    return bytesRead;
+}
+
+qint64 CachedDevice::writeData(const char *data, qint64 len)
+{
+    // Writing is not supported for this device.
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
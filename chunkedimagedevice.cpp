@@ -0,0 +1,176 @@
+#include "headers/chunkedimagedevice.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+bool isAllZero(const QByteArray &data)
+{
+    return std::all_of(data.constBegin(), data.constEnd(), [](char c) { return c == 0; });
+}
+}
+
+ChunkedImageDevice::ChunkedImageDevice(QObject *parent)
+    : QIODevice(parent),
+    m_mediaSize(0),
+    m_chunkSize(64 * 1024),
+    m_chunkCache(static_cast<int>(DefaultCacheBudget / 1024))
+{
+}
+
+ChunkedImageDevice::~ChunkedImageDevice()
+{
+    QIODevice::close();
+}
+
+void ChunkedImageDevice::setGeometry(qint64 mediaSize, qint64 chunkSize)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_mediaSize = mediaSize;
+    m_chunkSize = chunkSize;
+    m_chunkCache.clear();
+    m_zeroChunks = QBitArray(static_cast<qsizetype>((mediaSize + chunkSize - 1) / chunkSize));
+}
+
+qint64 ChunkedImageDevice::size() const
+{
+    return m_mediaSize;
+}
+
+qint64 ChunkedImageDevice::mediaSize() const
+{
+    return m_mediaSize;
+}
+
+qint64 ChunkedImageDevice::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+qint64 ChunkedImageDevice::zeroChunkCount() const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return m_zeroChunks.count(true);
+}
+
+// Zero chunks are returned as an empty array with isZero set
+QByteArray ChunkedImageDevice::chunk(qint64 chunkIndex, bool *isZero)
+{
+    *isZero = false;
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (m_zeroChunks.testBit(chunkIndex)) {
+            *isZero = true;
+            return QByteArray();
+        }
+        QByteArray *cached = m_chunkCache.object(chunkIndex);
+        if (cached) {
+            m_statistics.recordCacheHit();
+            return *cached;
+        }
+    }
+
+    m_statistics.recordCacheMiss();
+    const qint64 chunkStart = chunkIndex * m_chunkSize;
+    QByteArray chunkData(qMin(m_chunkSize, m_mediaSize - chunkStart), Qt::Uninitialized);
+    {
+        QMutexLocker locker(&m_handleMutex);
+        if (!readChunkFromImage(chunkStart, chunkData.data(), chunkData.size())) {
+            return QByteArray();
+        }
+    }
+
+    QMutexLocker locker(&m_cacheMutex);
+    if (isAllZero(chunkData)) {
+        m_zeroChunks.setBit(chunkIndex);
+        *isZero = true;
+        return QByteArray();
+    }
+    m_chunkCache.insert(chunkIndex, new QByteArray(chunkData), qMax<qint64>(1, chunkData.size() / 1024));
+    return chunkData;
+}
+
+qint64 ChunkedImageDevice::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= m_mediaSize) {
+        return 0;
+    }
+
+    IoStatistics::ReadTimer timer(m_statistics);
+    const qint64 bytesToRead = qMin(maxlen, m_mediaSize - offset);
+    qint64 bytesRead = 0;
+
+    while (bytesRead < bytesToRead) {
+        const qint64 position = offset + bytesRead;
+        const qint64 chunkIndex = position / m_chunkSize;
+        const qint64 chunkOffset = position % m_chunkSize;
+        const qint64 chunkLength = qMin(m_chunkSize, m_mediaSize - chunkIndex * m_chunkSize);
+        const qint64 bytesToCopy = qMin(bytesToRead - bytesRead, chunkLength - chunkOffset);
+
+        bool isZero = false;
+        QByteArray chunkData = chunk(chunkIndex, &isZero);
+        if (isZero) {
+            memset(data + bytesRead, 0, bytesToCopy);
+        } else if (chunkData.size() >= chunkOffset + bytesToCopy) {
+            memcpy(data + bytesRead, chunkData.constData() + chunkOffset, bytesToCopy);
+        } else {
+            break;
+        }
+        bytesRead += bytesToCopy;
+    }
+
+    return timer.finish(bytesRead > 0 ? bytesRead : -1);
+}
+
+// Served from cached and known zero chunks only
+qint64 ChunkedImageDevice::tryReadAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= m_mediaSize) {
+        return 0;
+    }
+
+    const qint64 bytesToRead = qMin(maxlen, m_mediaSize - offset);
+    QMutexLocker locker(&m_cacheMutex);
+
+    qint64 bytesRead = 0;
+    while (bytesRead < bytesToRead) {
+        const qint64 position = offset + bytesRead;
+        const qint64 chunkIndex = position / m_chunkSize;
+        const qint64 chunkOffset = position % m_chunkSize;
+        const qint64 chunkLength = qMin(m_chunkSize, m_mediaSize - chunkIndex * m_chunkSize);
+        const qint64 bytesToCopy = qMin(bytesToRead - bytesRead, chunkLength - chunkOffset);
+
+        if (m_zeroChunks.testBit(chunkIndex)) {
+            memset(data + bytesRead, 0, bytesToCopy);
+        } else {
+            QByteArray *cached = m_chunkCache.object(chunkIndex);
+            if (!cached) {
+                return -1;
+            }
+            memcpy(data + bytesRead, cached->constData() + chunkOffset, bytesToCopy);
+        }
+        bytesRead += bytesToCopy;
+    }
+
+    return bytesRead;
+}
+
+qint64 ChunkedImageDevice::readData(char *data, qint64 maxlen)
+{
+    return readAt(QIODevice::pos(), data, maxlen);
+}
+
+qint64 ChunkedImageDevice::writeData(const char *data, qint64 len)
+{
+    // Writing is not supported for this device.
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
@@ -0,0 +1,360 @@
+#include "headers/errortolerantdevice.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+#include <iterator>
+
+namespace {
+const quint32 MapFileMagic = 0x42534d31; // "BSM1"
+const quint32 MapFileVersion = 1;
+}
+
+ErrorTolerantDevice::ErrorTolerantDevice(QIODevice *backend, qint64 sectorSize, const QString &evidencePath, QObject *parent)
+    : QIODevice(parent),
+    m_backend(backend),
+    m_source(dynamic_cast<EvidenceSource *>(backend)),
+    m_size(backend->size()),
+    m_sectorSize(qMax<qint64>(sectorSize, 1)),
+    m_evidencePath(evidencePath),
+    m_retryBudgetMs(DefaultRetryBudgetMs),
+    m_maxRetries(DefaultMaxRetries),
+    m_dirty(false),
+    m_mapLoaded(0)
+{
+    m_backend->setParent(this);
+    if (!m_source) {
+        qCritical() << "Error tolerant reads need a positional backend";
+    }
+}
+
+// Runs once, on the thread of the first read. The identity sector gets a single
+// attempt: a drive that can not return it is still read, only without a saved map.
+void ErrorTolerantDevice::loadMap()
+{
+    m_identity.resize(qMin(m_sectorSize, m_size));
+    if (readBackend(0, m_identity.data(), m_identity.size()) != m_identity.size()) {
+        qDebug() << "First sector unreadable, bad sectors of" << m_evidencePath << "are not remembered";
+        m_identity.clear();
+    } else if (load()) {
+        const qint64 count = badSectorCount();
+        qDebug() << "Loaded" << count << "known bad sectors for" << m_evidencePath;
+        if (count > 0) {
+            emit badSectorsFound(0, m_size);
+        }
+    }
+    m_mapLoaded.storeRelease(1);
+}
+
+ErrorTolerantDevice::~ErrorTolerantDevice()
+{
+    save();
+    QIODevice::close();
+}
+
+qint64 ErrorTolerantDevice::size() const
+{
+    return m_size;
+}
+
+qint64 ErrorTolerantDevice::mediaSize() const
+{
+    return m_size;
+}
+
+void ErrorTolerantDevice::setRetryBudget(int milliseconds)
+{
+    m_retryBudgetMs = qMax(0, milliseconds);
+}
+
+void ErrorTolerantDevice::setMaxRetries(int retries)
+{
+    m_maxRetries = qMax(0, retries);
+}
+
+const QByteArray &ErrorTolerantDevice::markerPattern()
+{
+    static const QByteArray pattern("** BAD SECTOR **");
+    return pattern;
+}
+
+// The pattern is anchored to absolute offsets so every read of a bad sector
+// returns the same bytes
+void ErrorTolerantDevice::fillMarker(qint64 offset, char *data, qint64 length)
+{
+    const QByteArray &pattern = markerPattern();
+    for (qint64 i = 0; i < length; ++i) {
+        data[i] = pattern.at((offset + i) % pattern.size());
+    }
+}
+
+qint64 ErrorTolerantDevice::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0 || !m_source) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= m_size) {
+        return 0;
+    }
+
+    std::call_once(m_mapOnce, [this]() { loadMap(); });
+
+    IoStatistics::ReadTimer timer(m_statistics);
+    const qint64 length = qMin(maxlen, m_size - offset);
+    const qint64 end = offset + length;
+    const QDeadlineTimer deadline(m_retryBudgetMs);
+
+    // Read the gaps between known bad ranges, which are filled without I/O
+    bool found = false;
+    qint64 position = offset;
+    const QList<QPair<qint64, qint64>> known = badRanges(offset, length);
+    for (const QPair<qint64, qint64> &range : known) {
+        if (range.first > position) {
+            found |= readSplit(position, data + (position - offset), range.first - position, deadline);
+        }
+        fillMarker(range.first, data + (range.first - offset), range.second - range.first);
+        position = range.second;
+    }
+    if (position < end) {
+        found |= readSplit(position, data + (position - offset), end - position, deadline);
+    }
+
+    if (found) {
+        qDebug() << "Bad sectors recorded while reading" << length << "bytes at" << offset;
+        save();
+        emit badSectorsFound(offset, length);
+    }
+    return timer.finish(length);
+}
+
+EvidenceSource *ErrorTolerantDevice::innerSource() const
+{
+    return m_source;
+}
+
+qint64 ErrorTolerantDevice::tryReadAt(qint64 offset, char *data, qint64 maxlen)
+{
+    // Until the map is loaded known bad sectors would be read again
+    if (!m_source || offset < 0 || maxlen < 0 || !m_mapLoaded.loadAcquire()) {
+        return -1;
+    }
+    const qint64 length = qMin(maxlen, m_size - offset);
+    if (length > 0 && !badRanges(offset, length).isEmpty()) {
+        return -1;
+    }
+    return m_source->tryReadAt(offset, data, maxlen);
+}
+
+// Returns true when new bad sectors were recorded
+bool ErrorTolerantDevice::readSplit(qint64 offset, char *data, qint64 length, const QDeadlineTimer &deadline)
+{
+    const qint64 bytesRead = readBackend(offset, data, length);
+    if (bytesRead >= length) {
+        return false;
+    }
+
+    // Keep the whole sectors that did arrive and continue from the first failing one
+    const qint64 good = qMax<qint64>(0, ((offset + bytesRead) / m_sectorSize) * m_sectorSize - offset);
+    offset += good;
+    data += good;
+    length -= good;
+
+    const qint64 firstSector = offset / m_sectorSize;
+    const qint64 lastSector = (offset + length - 1) / m_sectorSize;
+
+    int attempts = 0;
+    if (firstSector == lastSector) {
+        for (; attempts < m_maxRetries && !deadline.hasExpired(); ++attempts) {
+            if (readBackend(offset, data, length) == length) {
+                return false;
+            }
+        }
+    } else if (!deadline.hasExpired()) {
+        const qint64 middle = ((firstSector + lastSector + 1) / 2) * m_sectorSize;
+        const bool left = readSplit(offset, data, middle - offset, deadline);
+        const bool right = readSplit(middle, data + (middle - offset), offset + length - middle, deadline);
+        return left || right;
+    }
+
+    fillMarker(offset, data, length);
+    if (attempts < m_maxRetries) {
+        // Not verified, so it stays out of the saved map
+        qDebug() << "Retry budget spent, skipping" << length << "bytes at" << offset;
+        return false;
+    }
+    markBad(offset, length);
+    return true;
+}
+
+// Number of bytes read before the first error or the end of the media
+qint64 ErrorTolerantDevice::readBackend(qint64 offset, char *data, qint64 length)
+{
+    qint64 bytesRead = 0;
+    while (bytesRead < length) {
+        const qint64 count = m_source->readAt(offset + bytesRead, data + bytesRead, length - bytesRead);
+        if (count <= 0) {
+            break;
+        }
+        bytesRead += count;
+    }
+    return bytesRead;
+}
+
+void ErrorTolerantDevice::markBad(qint64 offset, qint64 length)
+{
+    qint64 first = offset / m_sectorSize;
+    qint64 end = (offset + length + m_sectorSize - 1) / m_sectorSize;
+
+    QMutexLocker locker(&m_mutex);
+
+    // Merge with every run that overlaps or touches [first, end)
+    auto it = m_badRuns.upperBound(first);
+    if (it != m_badRuns.begin() && std::prev(it).value() >= first) {
+        --it;
+    }
+    while (it != m_badRuns.end() && it.key() <= end) {
+        first = qMin(first, it.key());
+        end = qMax(end, it.value());
+        it = m_badRuns.erase(it);
+    }
+    m_badRuns.insert(first, end);
+    m_dirty = true;
+}
+
+QList<QPair<qint64, qint64>> ErrorTolerantDevice::badRanges(qint64 offset, qint64 length) const
+{
+    QList<QPair<qint64, qint64>> ranges;
+    if (length <= 0) {
+        return ranges;
+    }
+
+    const qint64 end = offset + length;
+    const qint64 firstSector = offset / m_sectorSize;
+    const qint64 endSector = (end + m_sectorSize - 1) / m_sectorSize;
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_badRuns.upperBound(firstSector);
+    if (it != m_badRuns.begin()) {
+        --it;
+    }
+    for (; it != m_badRuns.end() && it.key() < endSector; ++it) {
+        if (it.value() <= firstSector) {
+            continue;
+        }
+        ranges.append(qMakePair(qMax(offset, it.key() * m_sectorSize), qMin(end, it.value() * m_sectorSize)));
+    }
+    return ranges;
+}
+
+bool ErrorTolerantDevice::isBadSector(qint64 offset) const
+{
+    return !badRanges(offset, 1).isEmpty();
+}
+
+qint64 ErrorTolerantDevice::badSectorCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 count = 0;
+    for (auto it = m_badRuns.constBegin(); it != m_badRuns.constEnd(); ++it) {
+        count += it.value() - it.key();
+    }
+    return count;
+}
+
+void ErrorTolerantDevice::clearBadSectors()
+{
+    if (!m_mapLoaded.loadAcquire()) {
+        return; // Nothing recorded yet
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_badRuns.clear();
+        m_dirty = true;
+    }
+    save();
+}
+
+bool ErrorTolerantDevice::load()
+{
+    QFile file(mapFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 mediaSize = 0;
+    qint64 sectorSize = 0;
+    QMap<qint64, qint64> badRuns;
+    in >> magic >> version >> mediaSize >> sectorSize >> badRuns;
+
+    if (in.status() != QDataStream::Ok || magic != MapFileMagic || version != MapFileVersion
+        || mediaSize != m_size || sectorSize != m_sectorSize) {
+        qDebug() << "Ignoring stale bad sector map" << file.fileName();
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_badRuns = badRuns;
+    return true;
+}
+
+void ErrorTolerantDevice::save()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_dirty) {
+        return;
+    }
+
+    const QString mapPath = mapFilePath();
+    QDir().mkpath(QFileInfo(mapPath).absolutePath());
+    QSaveFile file(mapPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to save bad sector map:" << file.errorString();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << MapFileMagic << MapFileVersion << m_size << m_sectorSize << m_badRuns;
+
+    if (!file.commit()) {
+        qDebug() << "Failed to save bad sector map:" << file.errorString();
+        return;
+    }
+    m_dirty = false;
+}
+
+// Drives have no modification time, the first sector stands in for it
+QString ErrorTolerantDevice::mapFilePath() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_evidencePath.toUtf8());
+    hash.addData(QByteArray::number(m_size));
+    hash.addData(m_identity);
+
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + "/badsectors/" + QString::fromLatin1(hash.result().toHex()) + ".map";
+}
+
+qint64 ErrorTolerantDevice::readData(char *data, qint64 maxlen)
+{
+    return readAt(QIODevice::pos(), data, maxlen);
+}
+
+qint64 ErrorTolerantDevice::writeData(const char *data, qint64 len)
+{
+    // Writing is not supported for this device.
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
@@ -0,0 +1,161 @@
+#include "headers/evidencefile.h"
+#include <QDebug>
+#include <QFile>
+
+#ifndef Q_OS_WIN
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#endif
+
+EvidenceFile::EvidenceFile(const QString &fileName, QObject *parent)
+    : QIODevice(parent),
+    m_fileName(fileName),
+    m_fileSize(0),
+#ifdef Q_OS_WIN
+    m_handle(INVALID_HANDLE_VALUE)
+#else
+    m_fd(-1)
+#endif
+{
+}
+
+EvidenceFile::~EvidenceFile()
+{
+    close();
+}
+
+bool EvidenceFile::open(OpenMode mode)
+{
+    if (mode & QIODevice::WriteOnly) {
+        qDebug() << "Evidence files can only be opened for reading.";
+        return false;
+    }
+
+#ifdef Q_OS_WIN
+    m_handle = CreateFile(m_fileName.toStdWString().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_handle == INVALID_HANDLE_VALUE) {
+        qCritical() << "Failed to open evidence file" << m_fileName;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_handle, &fileSize)) {
+        qCritical() << "Failed to get size of evidence file" << m_fileName;
+        CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    m_fileSize = fileSize.QuadPart;
+#else
+    m_fd = ::open(QFile::encodeName(m_fileName).constData(), O_RDONLY);
+    if (m_fd < 0) {
+        qCritical() << "Failed to open evidence file" << m_fileName;
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(m_fd, &fileStat) != 0) {
+        qCritical() << "Failed to get size of evidence file" << m_fileName;
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    m_fileSize = fileStat.st_size;
+#endif
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void EvidenceFile::close()
+{
+#ifdef Q_OS_WIN
+    if (m_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    QIODevice::close();
+}
+
+qint64 EvidenceFile::size() const
+{
+    return m_fileSize;
+}
+
+qint64 EvidenceFile::mediaSize() const
+{
+    return m_fileSize;
+}
+
+qint64 EvidenceFile::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (offset >= m_fileSize || maxlen == 0) {
+        return 0;
+    }
+
+    qint64 bytesToRead = qMin(maxlen, m_fileSize - offset);
+    IoStatistics::ReadTimer timer(m_statistics);
+
+#ifdef Q_OS_WIN
+    // The offset travels with the request, the handle position is not used
+    qint64 bytesRead = 0;
+    while (bytesRead < bytesToRead) {
+        OVERLAPPED overlapped = {};
+        qint64 position = offset + bytesRead;
+        overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+        DWORD count = 0;
+        DWORD request = static_cast<DWORD>(qMin<qint64>(bytesToRead - bytesRead, 0x40000000));
+        if (!ReadFile(m_handle, data + bytesRead, request, &count, &overlapped)) {
+            qCritical() << "Failed to read evidence file at position" << position;
+            return timer.finish(bytesRead > 0 ? bytesRead : -1);
+        }
+        if (count == 0) {
+            break;
+        }
+        bytesRead += count;
+    }
+    return timer.finish(bytesRead);
+#else
+    qint64 bytesRead = 0;
+    while (bytesRead < bytesToRead) {
+        ssize_t count = pread(m_fd, data + bytesRead, static_cast<size_t>(bytesToRead - bytesRead), static_cast<off_t>(offset + bytesRead));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qCritical() << "Failed to read evidence file at position" << offset + bytesRead;
+            return timer.finish(bytesRead > 0 ? bytesRead : -1);
+        }
+        if (count == 0) {
+            break;
+        }
+        bytesRead += count;
+    }
+    return timer.finish(bytesRead);
+#endif
+}
+
+qint64 EvidenceFile::readData(char *data, qint64 maxlen)
+{
+    return readAt(QIODevice::pos(), data, maxlen);
+}
+
+qint64 EvidenceFile::writeData(const char *data, qint64 len)
+{
+    // Writing is not supported for this device.
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
@@ -0,0 +1,141 @@
+#include "headers/evidencesource.h"
+#include <QObject>
+#include <algorithm>
+#include <cstring>
+
+qint64 EvidenceSource::readFully(qint64 offset, char *data, qint64 length)
+{
+    qint64 bytesRead = 0;
+    while (bytesRead < length) {
+        qint64 count = readAt(offset + bytesRead, data + bytesRead, length - bytesRead);
+        if (count < 0) {
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+        if (count == 0) {
+            break; // End of the media
+        }
+        bytesRead += count;
+    }
+    return bytesRead;
+}
+
+qint64 EvidenceSource::tryReadAt(qint64 offset, char *data, qint64 maxlen)
+{
+    Q_UNUSED(offset);
+    Q_UNUSED(data);
+    Q_UNUSED(maxlen);
+    return -1;
+}
+
+qint64 EvidenceSource::readUncached(qint64 offset, char *data, qint64 maxlen)
+{
+    return readAt(offset, data, maxlen);
+}
+
+IoStatistics &EvidenceSource::statistics()
+{
+    return m_statistics;
+}
+
+EvidenceSource *EvidenceSource::innerSource() const
+{
+    return nullptr;
+}
+
+// Every device is also a QIODevice, its meta object names the layer
+QString EvidenceSource::layerName() const
+{
+    const QObject *object = dynamic_cast<const QObject *>(this);
+    return object ? QString::fromLatin1(object->metaObject()->className()) : QStringLiteral("EvidenceSource");
+}
+
+QByteArray EvidenceSource::readBytes(qint64 offset, qint64 length)
+{
+    QByteArray data;
+    if (length <= 0) {
+        return data;
+    }
+
+    data.resize(length);
+    qint64 bytesRead = readFully(offset, data.data(), length);
+    data.resize(qMax<qint64>(bytesRead, 0));
+    return data;
+}
+
+void EvidenceSource::prefetch(qint64 offset, qint64 length)
+{
+    if (offset < 0 || length <= 0) {
+        return;
+    }
+
+    QByteArray scratch(qMin(length, MaxCoalescedRead), Qt::Uninitialized);
+    qint64 done = 0;
+    while (done < length) {
+        const qint64 count = readAt(offset + done, scratch.data(), qMin(length - done, static_cast<qint64>(scratch.size())));
+        if (count <= 0) {
+            break;
+        }
+        done += count;
+    }
+}
+
+qint64 EvidenceSource::readv(QList<ReadRequest> &requests)
+{
+    QList<int> order;
+    order.reserve(requests.size());
+    for (int i = 0; i < requests.size(); ++i) {
+        requests[i].bytesRead = 0;
+        if (requests[i].length > 0) {
+            order.append(i);
+        }
+    }
+
+    std::sort(order.begin(), order.end(), [&requests](int a, int b) {
+        return requests[a].offset < requests[b].offset;
+    });
+
+    qint64 totalRead = 0;
+    QByteArray buffer;
+
+    int first = 0;
+    while (first < order.size()) {
+        // Grow the group while the next request starts close enough
+        const qint64 groupStart = requests[order[first]].offset;
+        qint64 groupEnd = groupStart + requests[order[first]].length;
+        int last = first + 1;
+        while (last < order.size()) {
+            const ReadRequest &next = requests[order[last]];
+            const qint64 nextEnd = qMax(groupEnd, next.offset + next.length);
+            if (next.offset > groupEnd + MaxCoalesceGap || nextEnd - groupStart > MaxCoalescedRead) {
+                break;
+            }
+            groupEnd = nextEnd;
+            ++last;
+        }
+
+        if (last - first == 1) {
+            ReadRequest &request = requests[order[first]];
+            request.bytesRead = readFully(request.offset, request.data, request.length);
+            totalRead += qMax<qint64>(request.bytesRead, 0);
+        } else {
+            buffer.resize(groupEnd - groupStart);
+            const qint64 groupRead = readFully(groupStart, buffer.data(), buffer.size());
+
+            for (int i = first; i < last; ++i) {
+                ReadRequest &request = requests[order[i]];
+                if (groupRead < 0) {
+                    request.bytesRead = -1;
+                    continue;
+                }
+                const qint64 available = groupRead - (request.offset - groupStart);
+                request.bytesRead = qBound<qint64>(0, available, request.length);
+                memcpy(request.data, buffer.constData() + (request.offset - groupStart), request.bytesRead);
+                totalRead += request.bytesRead;
+            }
+        }
+
+        first = last;
+    }
+
+    return totalRead;
+}
@@ -1,87 +1,339 @@
 #include "headers/ewfdevice.h"
 #include <QDebug>
-#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+#include <cstring>
+
+namespace {
+// libewf default, used when the chunk size can not be read from the image
+const size32_t DefaultChunkSize = 32768;
+// Share of the chunk cache budget a single image may fill
+const qint64 CacheBudgetShare = 4;
+}
+
 EwfDevice::EwfDevice(QObject *parent)
-    : QIODevice(parent), m_ewfHandle(nullptr), m_mediaSize(0), m_fileSize(0), m_error(nullptr)
+    : QIODevice(parent),
+    m_ewfHandle(nullptr),
+    m_mediaSize(0),
+    m_chunkSize(DefaultChunkSize),
+    m_chunkCache(MaxCachedChunks),
+    m_pooledHandleCount(0),
+    m_maxPooledHandles(qMax(1, QThread::idealThreadCount())),
+    m_diskCache(nullptr),
+    m_error(nullptr)
+{
+}
+
+libewf_handle_t *EwfDevice::openHandle()
+{
+    const char *filenames[] = { m_filePath.constData(), nullptr };
+    libewf_handle_t *handle = nullptr;
+    libewf_error_t *error = nullptr;
+
+    if (libewf_handle_initialize(&handle, &error) != 1) {
+        libewf_error_fprint(error, stderr);
+        libewf_error_free(&error);
+        return nullptr;
+    }
+
+    if (libewf_handle_open(handle, const_cast<char **>(filenames), 1, LIBEWF_OPEN_READ, &error) != 1) {
+        libewf_error_fprint(error, stderr);
+        libewf_error_free(&error);
+        libewf_handle_free(&handle, nullptr);
+        return nullptr;
+    }
+
+    return handle;
+}
+
+void EwfDevice::closeHandle(libewf_handle_t *handle)
 {
+    libewf_handle_close(handle, nullptr);
+    libewf_handle_free(&handle, nullptr);
 }
 
 bool EwfDevice::openEwf(const char *ewfFilePath, OpenMode mode)
 {
-    const char *filenames[] = { ewfFilePath, nullptr };
+    m_filePath = QByteArray(ewfFilePath);
 
-    if (libewf_handle_initialize(&m_ewfHandle, &m_error) == 0) {
-        libewf_error_fprint(m_error, stderr);
-        libewf_error_free(&m_error);
+    m_ewfHandle = openHandle();
+    if (!m_ewfHandle) {
         return false;
     }
 
-    if (libewf_handle_open(m_ewfHandle, const_cast<char **>(filenames), 1, LIBEWF_OPEN_READ, &m_error) == 0) {
+    if (libewf_handle_get_media_size(m_ewfHandle, &m_mediaSize, &m_error) != 1) {
         libewf_error_fprint(m_error, stderr);
         libewf_error_free(&m_error);
-        libewf_handle_free(&m_ewfHandle, nullptr);
-        m_ewfHandle = nullptr;
-        return false;
     }
 
-    if (libewf_handle_get_media_size(m_ewfHandle, &m_mediaSize, &m_error) == 0) {
+    if (libewf_handle_get_chunk_size(m_ewfHandle, &m_chunkSize, &m_error) != 1 || m_chunkSize == 0) {
         libewf_error_fprint(m_error, stderr);
         libewf_error_free(&m_error);
+        m_chunkSize = DefaultChunkSize;
     }
-                QFileInfo fileInfo(ewfFilePath);
-                m_fileSize = fileInfo.size();
-                qDebug() << "Media size is " << m_mediaSize;
+    qDebug() << "Media size is " << m_mediaSize << "chunk size is" << m_chunkSize;
 
     return QIODevice::open(mode);
 }
 
 qint64 EwfDevice::size() const
 {
-    return m_fileSize;
+    return static_cast<qint64>(m_mediaSize);
+}
+
+qint64 EwfDevice::mediaSize() const
+{
+    return static_cast<qint64>(m_mediaSize);
+}
+
+qint64 EwfDevice::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+// Hex MD5 of the media followed by the segment file set GUID, empty when neither is stored
+QString EwfDevice::evidenceKey()
+{
+    uint8_t md5[16] = {};
+    uint8_t guid[16] = {};
+    bool hasMd5 = false;
+    bool hasGuid = false;
+
+    int result = libewf_handle_get_md5_hash(m_ewfHandle, md5, sizeof(md5), &m_error);
+    if (result == -1) {
+        libewf_error_free(&m_error);
+    }
+    hasMd5 = result == 1;
+
+    if (libewf_handle_get_segment_file_set_identifier(m_ewfHandle, guid, sizeof(guid), &m_error) != 1) {
+        libewf_error_free(&m_error);
+    } else {
+        hasGuid = QByteArray(reinterpret_cast<const char *>(guid), sizeof(guid)).count('\0') != sizeof(guid);
+    }
+
+    if (!hasMd5 && !hasGuid) {
+        return QString();
+    }
+
+    QByteArray key = QByteArray(reinterpret_cast<const char *>(md5), sizeof(md5)).toHex();
+    key += '-';
+    key += QByteArray(reinterpret_cast<const char *>(guid), sizeof(guid)).toHex();
+    return QString::fromLatin1(key);
+}
+
+bool EwfDevice::enablePersistentCache(const QString &directory, qint64 maxSize)
+{
+    delete m_diskCache;
+    m_diskCache = nullptr;
+
+    if (!m_ewfHandle || maxSize <= 0) {
+        return false;
+    }
+
+    const QString key = evidenceKey();
+    if (key.isEmpty()) {
+        qDebug() << "EWF image has no MD5 or set identifier, chunk cache disabled";
+        return false;
+    }
+
+    // One image gets part of the budget, the rest keeps the caches of recently opened ones
+    const qint64 imageSize = maxSize / CacheBudgetShare;
+    PersistentChunkCache::trimDirectory(directory, maxSize - imageSize, key);
+
+    PersistentChunkCache *diskCache = new PersistentChunkCache(directory, key, m_chunkSize, imageSize);
+    if (!diskCache->open()) {
+        delete diskCache;
+        return false;
+    }
+    m_diskCache = diskCache;
+    return true;
+}
+
+void EwfDevice::setMaxPooledHandles(int count)
+{
+    QMutexLocker locker(&m_poolMutex);
+    m_maxPooledHandles = qMax(1, count);
 }
 
 EwfDevice::~EwfDevice()
 {
+    delete m_diskCache;
+    m_diskCache = nullptr;
+
     if (m_ewfHandle) {
-        libewf_handle_close(m_ewfHandle, nullptr);
-        libewf_handle_free(&m_ewfHandle, nullptr);
+        closeHandle(m_ewfHandle);
         m_ewfHandle = nullptr;
     }
-    QIODevice::close();
 
+    QMutexLocker locker(&m_poolMutex);
+    for (libewf_handle_t *handle : m_idleHandles) {
+        closeHandle(handle);
+    }
+    m_idleHandles.clear();
+    locker.unlock();
+
+    QIODevice::close();
 }
 
-qint64 EwfDevice::readData(char *data, qint64 maxlen)
+libewf_handle_t *EwfDevice::acquireHandle()
 {
-    qint64 pos = QIODevice::pos(); // Get the current position
-    //qDebug() << "read start..";
-    //qDebug() << "current pos: " << pos << ", maxlen: " << maxlen;
+    QMutexLocker locker(&m_poolMutex);
 
-    if (maxlen <= 0 || pos >= m_mediaSize) {
-       // qDebug() << "read error: length " << maxlen << " " << m_mediaSize;
-        return -1;
+    while (m_idleHandles.isEmpty() && m_pooledHandleCount >= m_maxPooledHandles) {
+        m_handleReleased.wait(&m_poolMutex);
     }
 
-    if (libewf_handle_seek_offset(m_ewfHandle, pos, SEEK_SET, &m_error) == -1) {
-        //qDebug() << "read error: seek failed with error";
-        libewf_error_fprint(m_error, stderr);
-        libewf_error_free(&m_error);
-        return -1;
+    if (!m_idleHandles.isEmpty()) {
+        return m_idleHandles.takeLast();
+    }
+
+    // Grow the pool, opening the segment files is done outside of the lock
+    m_pooledHandleCount++;
+    locker.unlock();
+
+    libewf_handle_t *handle = openHandle();
+    if (!handle) {
+        locker.relock();
+        m_pooledHandleCount--;
+        m_handleReleased.wakeOne();
     }
+    return handle;
+}
 
-    qint64 bytesToRead = qMin(static_cast<qint64>(maxlen), static_cast<qint64>(m_mediaSize - pos));
-    //qDebug() << "Reading " << bytesToRead << " bytes";
+void EwfDevice::releaseHandle(libewf_handle_t *handle)
+{
+    QMutexLocker locker(&m_poolMutex);
+    m_idleHandles.append(handle);
+    m_handleReleased.wakeOne();
+}
+
+bool EwfDevice::decompressChunk(libewf_handle_t *handle, qint64 chunkIndex, QByteArray &chunkData)
+{
+    libewf_error_t *error = nullptr;
+    qint64 chunkStart = chunkIndex * m_chunkSize;
+    qint64 chunkLength = qMin(static_cast<qint64>(m_chunkSize), static_cast<qint64>(m_mediaSize) - chunkStart);
+
+    if (libewf_handle_seek_offset(handle, chunkStart, SEEK_SET, &error) == -1) {
+        //qDebug() << "read error: seek failed with error";
+        libewf_error_fprint(error, stderr);
+        libewf_error_free(&error);
+        return false;
+    }
 
-    int read_count = libewf_handle_read_buffer(m_ewfHandle, reinterpret_cast<uint8_t *>(data), bytesToRead, &m_error);
+    chunkData.resize(chunkLength);
+    ssize_t read_count = libewf_handle_read_buffer(handle, reinterpret_cast<uint8_t *>(chunkData.data()), chunkLength, &error);
     if (read_count < 0) {
        // qDebug() << "read error: read buffer failed with error";
-        libewf_error_fprint(m_error, stderr);
-        libewf_error_free(&m_error);
+        libewf_error_fprint(error, stderr);
+        libewf_error_free(&error);
+        return false;
+    }
+
+    chunkData.resize(read_count);
+    return read_count > 0;
+}
+
+// A null handle means a handle is borrowed from the pool for a cache miss
+QByteArray EwfDevice::chunk(qint64 chunkIndex, libewf_handle_t *handle, bool useCaches)
+{
+    if (useCaches) {
+        QMutexLocker locker(&m_cacheMutex);
+        QByteArray *cached = m_chunkCache.object(chunkIndex);
+        if (cached) {
+            m_statistics.recordCacheHit();
+            return *cached;
+        }
+    }
+
+    QByteArray chunkData;
+    if (useCaches && m_diskCache && m_diskCache->read(chunkIndex, chunkData)) {
+        m_statistics.recordCacheHit();
+        QMutexLocker locker(&m_cacheMutex);
+        m_chunkCache.insert(chunkIndex, new QByteArray(chunkData));
+        return chunkData;
+    }
+
+    m_statistics.recordCacheMiss();
+    libewf_handle_t *readHandle = handle ? handle : acquireHandle();
+    if (!readHandle) {
+        return QByteArray();
+    }
+
+    IoStatistics::ReadTimer timer(m_decompressionStatistics);
+    bool decompressed = decompressChunk(readHandle, chunkIndex, chunkData);
+    timer.finish(decompressed ? chunkData.size() : -1);
+
+    if (!handle) {
+        releaseHandle(readHandle);
+    }
+
+    if (!decompressed) {
+        return QByteArray();
+    }
+    if (!useCaches) {
+        return chunkData;
+    }
+
+    if (m_diskCache) {
+        m_diskCache->write(chunkIndex, chunkData);
+    }
+
+    QMutexLocker locker(&m_cacheMutex);
+    m_chunkCache.insert(chunkIndex, new QByteArray(chunkData));
+    return chunkData;
+}
+
+qint64 EwfDevice::readChunks(qint64 offset, char *data, qint64 maxlen, libewf_handle_t *handle, bool useCaches)
+{
+    if (maxlen < 0 || offset < 0) {
+       // qDebug() << "read error: length " << maxlen << " " << m_mediaSize;
         return -1;
     }
+    if (maxlen == 0 || offset >= static_cast<qint64>(m_mediaSize)) {
+        return 0;
+    }
+
+    IoStatistics::ReadTimer timer(m_statistics);
+    qint64 bytesToRead = qMin(maxlen, static_cast<qint64>(m_mediaSize) - offset);
+    qint64 bytesRead = 0;
+
+    // Every chunk is decompressed once and then served from the chunk cache
+    while (bytesRead < bytesToRead) {
+        qint64 position = offset + bytesRead;
+        qint64 chunkOffset = position % m_chunkSize;
+
+        QByteArray chunkData = chunk(position / m_chunkSize, handle, useCaches);
+        if (chunkOffset >= chunkData.size()) {
+            break;
+        }
+
+        qint64 bytesToCopy = qMin(bytesToRead - bytesRead, static_cast<qint64>(chunkData.size()) - chunkOffset);
+        memcpy(data + bytesRead, chunkData.constData() + chunkOffset, bytesToCopy);
+        bytesRead += bytesToCopy;
+    }
+
+    return timer.finish(bytesRead > 0 ? bytesRead : -1);
+}
 
-    //qDebug() << "read complete, new pos: " << QIODevice::pos() + read_count;
-    return read_count;
+IoStatistics &EwfDevice::decompressionStatistics()
+{
+    return m_decompressionStatistics;
+}
+
+qint64 EwfDevice::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    return readChunks(offset, data, maxlen, nullptr);
+}
+
+qint64 EwfDevice::readUncached(qint64 offset, char *data, qint64 maxlen)
+{
+    return readChunks(offset, data, maxlen, nullptr, false);
+}
+
+qint64 EwfDevice::readData(char *data, qint64 maxlen)
+{
+    // The QIODevice interface keeps using its own handle
+    return readChunks(QIODevice::pos(), data, maxlen, m_ewfHandle);
 }
 
 qint64 EwfDevice::writeData(const char *data, qint64 len)
@@ -1,5 +1,6 @@
 #include "headers/filesystemhandler.h"
 #include "headers/filesystemexception.h"
+#include "headers/cacheddevice.h"
 #include <QDebug>
 #include <QDateTime>
 #include <tsk/libtsk.h>
@@ -11,13 +12,72 @@
 #include <QFile>
 #include <QIODevice>
 
+namespace {
+// Directory walks on large volumes revisit MFT and index blocks all over the image
+const qint64 DefaultImageCacheSize = 64 * 1024 * 1024;
+// Bigger than one line of the cache inside TSK, so file reads go straight to the image
+const qint64 ExportBufferSize = 4 * 1024 * 1024;
+
+// TSK image backed by an EvidenceSource, TSK_IMG_INFO must be the first member
+// because TSK hands the same pointer back to the callbacks
+struct ExternalImage {
+    TSK_IMG_INFO img_info;
+    EvidenceSource *source;
+    // Reads that missed the small cache inside TSK, by whether the page cache had them.
+    // TSK holds its cache lock around the callback, so plain counters do.
+    quint64 hits;
+    quint64 misses;
+};
+
+ssize_t readExternalImage(TSK_IMG_INFO *img, TSK_OFF_T offset, char *buf, size_t len)
+{
+    ExternalImage *image = reinterpret_cast<ExternalImage *>(img);
+    qint64 count = image->source->tryReadAt(offset, buf, static_cast<qint64>(len));
+    if (count == static_cast<qint64>(len)) {
+        ++image->hits;
+        return static_cast<ssize_t>(count);
+    }
+    ++image->misses;
+    count = image->source->readAt(offset, buf, static_cast<qint64>(len));
+    if (count < 0) {
+        tsk_error_reset();
+        tsk_error_set_errno(TSK_ERR_IMG_READ);
+        tsk_error_set_errstr("readExternalImage: read error at offset %" PRIdOFF, offset);
+    }
+    return static_cast<ssize_t>(count);
+}
+
+void closeExternalImage(TSK_IMG_INFO *img)
+{
+    // The source belongs to the hex view, only the wrapper is freed here
+    ExternalImage *image = reinterpret_cast<ExternalImage *>(img);
+    qDebug() << "TSK reads from the page cache:" << image->hits << "hits," << image->misses << "misses";
+    delete image;
+}
+
+void statExternalImage(TSK_IMG_INFO *img, FILE *hFile)
+{
+    tsk_fprintf(hFile, "IMAGE FILE INFORMATION\n");
+    tsk_fprintf(hFile, "--------------------------------------------\n");
+    tsk_fprintf(hFile, "Image Type: external (hex viewer evidence device)\n");
+    tsk_fprintf(hFile, "\nSize in bytes: %" PRIdOFF "\n", img->size);
+}
+}
+
 FileSystemHandler::FileSystemHandler(QObject *parent)
     : QObject(parent),
     fileSystemType(""),
     img(nullptr),
     vs(nullptr),
-    fsOpenedDirectly(false)
+    fsOpenedDirectly(false),
+    imageCacheSize(DefaultImageCacheSize),
+    reservedCache(nullptr)
+{
+}
+
+void FileSystemHandler::setImageCacheSize(qint64 bytes)
 {
+    imageCacheSize = qMax<qint64>(0, bytes);
 }
 
 FileSystemHandler::~FileSystemHandler()
@@ -45,17 +105,50 @@ bool FileSystemHandler::openImage(const QString &fileName)
             throw FileSystemException("Failed to open file: " + getLastError());
         }
 
-        vs = tsk_vs_open(img, 0, TSK_VS_TYPE_DETECT);
-        if (vs == nullptr) {
-            qDebug() << "Failed to open volume system, trying to open as file system...";
-            return openImageAsFileSystem();
-        }
+        return openVolumeSystem();
 
+}
 
+bool FileSystemHandler::openEvidence(EvidenceSource *source)
+{
+    closeImage();  // Close any previously opened image
 
+    if (source == nullptr) {
+        throw FileSystemException("No evidence device is open");
+    }
 
-        return true;
+    // The cache inside the prebuilt libtsk is fixed (32 lines of 64 KB behind one
+    // lock), so its misses are served by the page cache of the hex view, grown
+    // once so that browsing the hex view does not evict the file system metadata
+    CachedDevice *pageCache = dynamic_cast<CachedDevice *>(source);
+    if (pageCache && reservedCache != pageCache) {
+        pageCache->setMemoryBudget(pageCache->memoryBudget() + imageCacheSize);
+        reservedCache = pageCache;
+    }
+
+    // Zero initialised, TSK expects its cache fields to start out empty
+    ExternalImage *external = new ExternalImage();
+    external->source = source;
+
+    qDebug() << "Opening evidence device of" << source->mediaSize() << "bytes";
+    img = tsk_img_open_external(external, source->mediaSize(), 0, readExternalImage, closeExternalImage, statExternalImage);
+    if (img == nullptr) {
+        delete external;
+        throw FileSystemException("Failed to open evidence device: " + getLastError());
+    }
 
+    return openVolumeSystem();
+}
+
+bool FileSystemHandler::openVolumeSystem()
+{
+    vs = tsk_vs_open(img, 0, TSK_VS_TYPE_DETECT);
+    if (vs == nullptr) {
+        qDebug() << "Failed to open volume system, trying to open as file system...";
+        return openImageAsFileSystem();
+    }
+
+    return true;
 }
 
 bool FileSystemHandler::openImageAsFileSystem()
@@ -396,16 +489,42 @@ QByteArray FileSystemHandler::readFileContents(int partitionIndex, const QString
 }
 
 
+// Streams the file to disk instead of holding all of it in memory
 void FileSystemHandler::exportFileContents(int partitionIndex, const QString &filePath, const QString &destinationPath)
 {
-    QByteArray fileData = readFileContents(partitionIndex, filePath);
+    TSK_FS_INFO *fs = getFileSystem(partitionIndex);
+    if (!fs) {
+        throw FileSystemException("Invalid file system");
+    }
+
+    TSK_FS_FILE *file = tsk_fs_file_open(fs, nullptr, filePath.toStdString().c_str());
+    if (!file) {
+        throw FileSystemException("Failed to open file: " + filePath);
+    }
 
     QFile outFile(destinationPath);
     if (!outFile.open(QIODevice::WriteOnly)) {
+        tsk_fs_file_close(file);
         throw FileSystemException("Failed to open destination file: " + destinationPath);
     }
 
-    outFile.write(fileData);
+    QByteArray buffer(ExportBufferSize, Qt::Uninitialized);
+    ssize_t bytesRead;
+    TSK_OFF_T offset = 0;
+
+    while ((bytesRead = tsk_fs_file_read(file, offset, buffer.data(), buffer.size(), TSK_FS_FILE_READ_FLAG_NONE)) > 0) {
+        if (outFile.write(buffer.constData(), bytesRead) != bytesRead) {
+            tsk_fs_file_close(file);
+            throw FileSystemException("Failed to write destination file: " + outFile.errorString());
+        }
+        offset += bytesRead;
+    }
+
+    if (bytesRead < 0) {
+        qDebug() << "Error reading file: " << getLastError();
+    }
+
+    tsk_fs_file_close(file);
     outFile.close();
 }
 
@@ -0,0 +1,132 @@
+#include "headers/glyphatlas.h"
+#include <QFontMetrics>
+#include <QPainter>
+#include <cmath>
+
+namespace {
+const char HexDigits[] = "0123456789ABCDEF";
+// Grids of a band, in characters from the left edge of the band
+const int HexGridColumn = 0;
+const int AsciiGridColumn = 16 * 2;
+const int PlaceholderGridColumn = AsciiGridColumn + 16;
+const int BandColumns = PlaceholderGridColumn + 3;
+const QChar PlaceholderChar(0x00B7);
+
+QChar asciiChar(quint8 value)
+{
+    return (value < 32 || value > 126) ? QChar('.') : QChar(value);
+}
+}
+
+GlyphAtlas::GlyphAtlas()
+    : m_devicePixelRatio(0),
+    m_charWidth(0),
+    m_lineHeight(0),
+    m_ascent(0)
+{
+}
+
+QColor GlyphAtlas::inkColor(Ink ink)
+{
+    switch (ink) {
+    case Light:
+    case LightBold:
+        return Qt::white;
+    case Placeholder:
+        return Qt::lightGray;
+    case Address:
+        return Qt::darkMagenta;
+    default:
+        return Qt::black;
+    }
+}
+
+void GlyphAtlas::update(const QFont &font, qreal devicePixelRatio)
+{
+    if (!m_pixmap.isNull() && font == m_font && qFuzzyCompare(devicePixelRatio, m_devicePixelRatio)) {
+        return;
+    }
+
+    m_font = font;
+    m_devicePixelRatio = devicePixelRatio;
+
+    const QFontMetrics metrics(font);
+    m_charWidth = metrics.horizontalAdvance('0');
+    m_lineHeight = metrics.height();
+    m_ascent = metrics.ascent();
+
+    const int bandHeight = 16 * m_lineHeight;
+    const QSize logicalSize(BandColumns * m_charWidth, InkCount * bandHeight);
+    m_pixmap = QPixmap(std::ceil(logicalSize.width() * devicePixelRatio), std::ceil(logicalSize.height() * devicePixelRatio));
+    m_pixmap.setDevicePixelRatio(devicePixelRatio);
+    m_pixmap.fill(Qt::transparent);
+
+    QFont boldFont = font;
+    boldFont.setBold(true);
+
+    QPainter painter(&m_pixmap);
+    for (int ink = 0; ink < InkCount; ++ink) {
+        painter.setFont((ink == DarkBold || ink == LightBold) ? boldFont : font);
+        painter.setPen(inkColor(static_cast<Ink>(ink)));
+        const int bandTop = ink * bandHeight;
+
+        // Each glyph is clipped to its cell so wide bold glyphs can not bleed into a neighbour
+        for (int value = 0; value < 256; ++value) {
+            const int top = bandTop + (value / 16) * m_lineHeight;
+
+            const QString hex = QString(QChar(HexDigits[value >> 4])) + QChar(HexDigits[value & 0x0F]);
+            const int hexLeft = (HexGridColumn + (value % 16) * 2) * m_charWidth;
+            painter.setClipRect(hexLeft, top, 2 * m_charWidth, m_lineHeight);
+            painter.drawText(hexLeft, top + m_ascent, hex);
+
+            const int asciiLeft = (AsciiGridColumn + value % 16) * m_charWidth;
+            painter.setClipRect(asciiLeft, top, m_charWidth, m_lineHeight);
+            painter.drawText(asciiLeft, top + m_ascent, QString(asciiChar(value)));
+        }
+
+        const int placeholderLeft = PlaceholderGridColumn * m_charWidth;
+        painter.setClipRect(placeholderLeft, bandTop, 3 * m_charWidth, m_lineHeight);
+        painter.drawText(placeholderLeft, bandTop + m_ascent, QString(2, PlaceholderChar));
+        painter.drawText(placeholderLeft + 2 * m_charWidth, bandTop + m_ascent, QString(PlaceholderChar));
+    }
+}
+
+// Source coordinates are logical, the pixmap is scaled by the device pixel ratio
+void GlyphAtlas::blit(QPainter &painter, int x, int baseline, int sourceX, int sourceY, int columns) const
+{
+    const QRectF target(x, baseline - m_ascent, columns * m_charWidth, m_lineHeight);
+    const QRectF source(sourceX * m_devicePixelRatio, sourceY * m_devicePixelRatio,
+                        columns * m_charWidth * m_devicePixelRatio, m_lineHeight * m_devicePixelRatio);
+    painter.drawPixmap(target, m_pixmap, source);
+}
+
+void GlyphAtlas::drawHexByte(QPainter &painter, int x, int baseline, quint8 value, Ink ink) const
+{
+    blit(painter, x, baseline, (HexGridColumn + (value % 16) * 2) * m_charWidth,
+         (ink * 16 + value / 16) * m_lineHeight, 2);
+}
+
+void GlyphAtlas::drawAsciiByte(QPainter &painter, int x, int baseline, quint8 value, Ink ink) const
+{
+    blit(painter, x, baseline, (AsciiGridColumn + value % 16) * m_charWidth,
+         (ink * 16 + value / 16) * m_lineHeight, 1);
+}
+
+void GlyphAtlas::drawHexPlaceholder(QPainter &painter, int x, int baseline) const
+{
+    blit(painter, x, baseline, PlaceholderGridColumn * m_charWidth, Placeholder * 16 * m_lineHeight, 2);
+}
+
+void GlyphAtlas::drawAsciiPlaceholder(QPainter &painter, int x, int baseline) const
+{
+    blit(painter, x, baseline, (PlaceholderGridColumn + 2) * m_charWidth, Placeholder * 16 * m_lineHeight, 1);
+}
+
+// Drawn as byte pairs, most significant first
+void GlyphAtlas::drawHexNumber(QPainter &painter, int x, int baseline, quint64 value, int digits, Ink ink) const
+{
+    for (int pair = digits / 2 - 1; pair >= 0; --pair) {
+        drawHexByte(painter, x, baseline, static_cast<quint8>(value >> (pair * 8)), ink);
+        x += 2 * m_charWidth;
+    }
+}
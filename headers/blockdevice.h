@@ -0,0 +1,70 @@
+#ifndef BLOCKDEVICE_H
+#define BLOCKDEVICE_H
+
+#include <QIODevice>
+#include <QString>
+#include <QMutex>
+#include "evidencesource.h"
+
+#ifdef Q_OS_LINUX
+
+// Live block device (or plain file) on Linux, read with O_DIRECT so large scans
+// bypass the page cache and run at the speed of the drive. All transfers are
+// aligned to the logical sector size. Small reads from the hex view go through
+// a single cached view unit, large reads are split into scan read units.
+class BlockDevice : public QIODevice, public EvidenceSource
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 MinScanReadUnit = 1024 * 1024;
+    static constexpr qint64 MaxScanReadUnit = 8 * 1024 * 1024;
+    static constexpr qint64 ViewReadUnit = 64 * 1024;
+
+    explicit BlockDevice(const QString &devicePath, QObject *parent = nullptr);
+    ~BlockDevice();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    qint64 size() const override;
+
+    qint64 mediaSize() const override;
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+    qint64 tryReadAt(qint64 offset, char *data, qint64 maxlen) override;
+
+    qint64 sectorSize() const;
+    bool isDirectIo() const;
+
+    // Clamped to [MinScanReadUnit, MaxScanReadUnit] and rounded to whole sectors
+    void setScanReadUnit(qint64 bytes);
+    qint64 scanReadUnit() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    qint64 readAligned(qint64 alignedOffset, char *alignedBuffer, qint64 alignedLength);
+    qint64 readUnbuffered(qint64 offset, char *data, qint64 maxlen, qint64 unit);
+    qint64 readThroughViewUnit(qint64 offset, char *data, qint64 maxlen);
+    bool reopenBuffered();
+
+    QString m_devicePath;
+    int m_fd;
+    bool m_directIo;
+    qint64 m_size;
+    qint64 m_sectorSize;
+    qint64 m_scanReadUnit;
+
+    // Last view unit, serves repeated small reads of the same region
+    QMutex m_viewMutex;
+    char *m_viewBuffer;
+    qint64 m_viewStart;
+    qint64 m_viewLength;
+
+    QMutex m_reopenMutex;
+};
+
+#endif // Q_OS_LINUX
+
+#endif // BLOCKDEVICE_H
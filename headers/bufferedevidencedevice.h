@@ -0,0 +1,87 @@
+#ifndef BUFFEREDEVIDENCEDEVICE_H
+#define BUFFEREDEVIDENCEDEVICE_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QMutex>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include "evidencesource.h"
+
+// Read buffer placed in front of any evidence backend (QFile, EwfDevice, a
+// physical drive...). The backend only ever sees reads of whole, aligned blocks,
+// which sector based media require and which turn many small reads into a few
+// large ones. The policy decides the block size and how many blocks are kept.
+class BufferedEvidenceDevice : public QIODevice, public EvidenceSource
+{
+    Q_OBJECT
+
+public:
+    struct Policy {
+        qint64 blockSize = 4096;
+        qint64 alignment = 512;  // Block starts and lengths are multiples of this
+        int slotCount = 64;
+        bool readAhead = false;  // Fill the next block in the background
+        bool uncached = false;   // Read the source past its own caches
+
+        // Small blocks and many slots for the hex view jumping around
+        static Policy interactive(qint64 alignment = 512);
+        // Large double-buffered blocks for scans: the next block is read while
+        // the caller works on the current one
+        static Policy streaming(qint64 alignment = 4096);
+    };
+
+    // Takes ownership of the backend, which must already be open for reading
+    BufferedEvidenceDevice(QIODevice *backend, const Policy &policy, QObject *parent = nullptr);
+    // Buffers a source owned elsewhere, for example for the duration of a scan
+    BufferedEvidenceDevice(EvidenceSource *source, const Policy &policy, QObject *parent = nullptr);
+    ~BufferedEvidenceDevice();
+
+    qint64 size() const override;
+
+    qint64 mediaSize() const override;
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+    qint64 tryReadAt(qint64 offset, char *data, qint64 maxlen) override;
+    EvidenceSource *innerSource() const override;
+
+    Policy policy() const;
+    // Drops the buffered blocks, e.g. once the data below them may have changed
+    void clearBuffer();
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    struct Slot {
+        qint64 start = -1;
+        QByteArray data;
+        quint64 lastUse = 0;
+        bool loading = false;
+    };
+
+    static Policy normalized(Policy policy);
+    QByteArray block(qint64 blockStart);
+    int claimSlot(qint64 blockStart);
+    void finishSlot(int slot, const QByteArray &data);
+    void scheduleReadAhead(qint64 blockStart);
+    QByteArray readBlock(qint64 blockStart);
+    qint64 readBackend(qint64 offset, char *data, qint64 length);
+
+    QIODevice *m_backend;     // Null when buffering a source that is not owned
+    EvidenceSource *m_source; // Positional reads when the backend supports them
+    qint64 m_size;
+    Policy m_policy;
+
+    // Guarded by m_mutex, waiters are woken when a loading slot is filled
+    QVector<Slot> m_slots;
+    quint64 m_useCounter;
+    QMutex m_mutex;
+    QWaitCondition m_slotLoaded;
+
+    QMutex m_backendMutex; // Plain QIODevice backends keep a single seek position
+    QThreadPool m_readAheadPool;
+};
+
+#endif // BUFFEREDEVIDENCEDEVICE_H
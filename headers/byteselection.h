@@ -0,0 +1,39 @@
+#ifndef BYTESELECTION_H
+#define BYTESELECTION_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// Selected bytes of a hex view as sorted, non-overlapping [start, end] ranges.
+// Selecting gigabytes costs one range instead of one entry per byte, and the
+// ranges are absolute file offsets so they may extend beyond the viewport.
+class ByteSelection
+{
+public:
+    struct Range {
+        quint64 start;
+        quint64 end; // Inclusive
+    };
+
+    void clear();
+    bool isEmpty() const;
+
+    // first and last may be given in either order, touching ranges are merged
+    void addRange(quint64 first, quint64 last);
+
+    bool contains(quint64 offset) const;
+    // Ranges overlapping [from, to) in order, for painting a row
+    QVector<Range> rangesIn(quint64 from, quint64 to) const;
+    const QVector<Range> &ranges() const;
+
+    quint64 totalLength() const;
+    quint64 firstOffset() const;
+    quint64 lastOffset() const;
+
+private:
+    int firstEndingAtOrAfter(quint64 offset) const;
+
+    QVector<Range> m_ranges;
+};
+
+#endif // BYTESELECTION_H
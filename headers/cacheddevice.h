@@ -0,0 +1,61 @@
+#ifndef CACHEDDEVICE_H
+#define CACHEDDEVICE_H
+
+#include <QIODevice>
+#include <QCache>
+#include <QMutex>
+#include <QByteArray>
+#include "evidencesource.h"
+
+// Read-only page cache placed in front of an evidence backend (QFile, EwfDevice,
+// WindowsDriveDevice...). Reads are served from fixed-size, page-aligned blocks
+// kept in an LRU that is bounded by a memory budget, so revisiting a region never
+// touches the backend again while it is still cached.
+class CachedDevice : public QIODevice, public EvidenceSource
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 DefaultPageSize = 64 * 1024;
+    static constexpr qint64 DefaultMemoryBudget = 256 * 1024 * 1024;
+
+    // Takes ownership of the backend, which must already be open for reading.
+    explicit CachedDevice(QIODevice *backend, qint64 pageSize = DefaultPageSize, QObject *parent = nullptr);
+    ~CachedDevice();
+
+    qint64 size() const override;
+
+    qint64 mediaSize() const override;
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+    qint64 tryReadAt(qint64 offset, char *data, qint64 maxlen) override;
+    void prefetch(qint64 offset, qint64 length) override;
+    EvidenceSource *innerSource() const override;
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    qint64 pageSize() const;
+    void clearCache();
+
+    QIODevice *backend() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    QByteArray cachedPage(qint64 pageIndex) const;
+    void insertPage(qint64 pageIndex, const QByteArray &page);
+    QByteArray loadPage(qint64 pageIndex);
+    void loadPages(qint64 firstPage, qint64 count);
+
+    QIODevice *m_backend;
+    EvidenceSource *m_source; // Positional reads when the backend supports them
+    qint64 m_pageSize;
+    qint64 m_memoryBudget;
+
+    // Cost of each entry is one page, maxCost is the budget expressed in pages
+    QCache<qint64, QByteArray> m_pages;
+    mutable QMutex m_mutex;
+};
+
+#endif // CACHEDDEVICE_H
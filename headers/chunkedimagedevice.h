@@ -0,0 +1,56 @@
+#ifndef CHUNKEDIMAGEDEVICE_H
+#define CHUNKEDIMAGEDEVICE_H
+
+#include <QIODevice>
+#include <QCache>
+#include <QByteArray>
+#include <QBitArray>
+#include <QMutex>
+#include "evidencesource.h"
+
+// Base for container formats read through a library handle that is not thread
+// safe (libvmdk, libvhdi). The guest media is read in grain/block aligned chunks
+// that are cached, and chunks found to be all zero (sparse, unallocated) are
+// remembered in a bitmap and served without calling into the library again.
+class ChunkedImageDevice : public QIODevice, public EvidenceSource
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 DefaultCacheBudget = 64 * 1024 * 1024;
+
+    explicit ChunkedImageDevice(QObject *parent = nullptr);
+    ~ChunkedImageDevice();
+
+    qint64 size() const override;
+    qint64 mediaSize() const override;
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+    qint64 tryReadAt(qint64 offset, char *data, qint64 maxlen) override;
+
+    qint64 chunkSize() const;
+    qint64 zeroChunkCount() const;
+
+protected:
+    // Called by subclasses once the image is open
+    void setGeometry(qint64 mediaSize, qint64 chunkSize);
+
+    // Reads one chunk from the container, called with the handle lock held
+    virtual bool readChunkFromImage(qint64 offset, char *data, qint64 length) = 0;
+
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    QByteArray chunk(qint64 chunkIndex, bool *isZero);
+
+    qint64 m_mediaSize;
+    qint64 m_chunkSize;
+
+    QMutex m_handleMutex;
+
+    mutable QMutex m_cacheMutex;
+    QCache<qint64, QByteArray> m_chunkCache; // Cost in KB
+    QBitArray m_zeroChunks;
+};
+
+#endif // CHUNKEDIMAGEDEVICE_H
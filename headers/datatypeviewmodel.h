@@ -13,6 +13,9 @@ class DataTypeViewModel : public QAbstractTableModel
 public:
     explicit DataTypeViewModel(QObject *parent = nullptr);
 
+    // Longest value interpreted (the GUID), callers need not pass more bytes
+    static constexpr int MaxInterpretedBytes = 16;
+
     void updateData(const QByteArray &data);
     void setEndian(bool littleEndian);  // Method to set the endian mode
 
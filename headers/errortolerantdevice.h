@@ -0,0 +1,99 @@
+#ifndef ERRORTOLERANTDEVICE_H
+#define ERRORTOLERANTDEVICE_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QDeadlineTimer>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QAtomicInt>
+#include <mutex>
+#include "evidencesource.h"
+
+// Keeps reads of failing media going. A read the backend can not complete is
+// split down to single sectors, unreadable sectors are filled with the marker
+// pattern and recorded in a bad sector map that is saved per evidence. Later
+// reads skip known bad sectors without touching the drive again.
+//
+// Retries are bounded by a time budget per read. Once it is spent a failing
+// range is no longer split but filled with the marker as a whole, so a scan over
+// a dead region keeps moving instead of waiting for every sector to time out.
+// Only sectors that failed every retry are recorded, the skipped ones are tried
+// again by the next read that reaches them.
+//
+// The saved map is keyed by the first sector, which is read together with the
+// first read instead of while opening, so the GUI never waits on the drive.
+class ErrorTolerantDevice : public QIODevice, public EvidenceSource
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultRetryBudgetMs = 2000;
+    static constexpr int DefaultMaxRetries = 2;
+
+    // Takes ownership of the backend, which must already be open for reading.
+    // evidencePath identifies the saved bad sector map.
+    ErrorTolerantDevice(QIODevice *backend, qint64 sectorSize, const QString &evidencePath, QObject *parent = nullptr);
+    ~ErrorTolerantDevice();
+
+    qint64 size() const override;
+
+    qint64 mediaSize() const override;
+    // Never fails inside the media: unreadable sectors come back as the marker
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+    qint64 tryReadAt(qint64 offset, char *data, qint64 maxlen) override;
+    EvidenceSource *innerSource() const override;
+
+    void setRetryBudget(int milliseconds);
+    void setMaxRetries(int retries);
+
+    bool isBadSector(qint64 offset) const;
+    // Bad byte ranges [first, second) overlapping [offset, offset + length)
+    QList<QPair<qint64, qint64>> badRanges(qint64 offset, qint64 length) const;
+    qint64 badSectorCount() const;
+    // Forgets the map so the next reads try the drive again, cached copies of the
+    // marked sectors above this device have to be dropped by the caller
+    void clearBadSectors();
+
+    static const QByteArray &markerPattern();
+
+signals:
+    // Emitted from the reading thread when new bad sectors were recorded
+    void badSectorsFound(qint64 offset, qint64 length);
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    void loadMap();
+    bool readSplit(qint64 offset, char *data, qint64 length, const QDeadlineTimer &deadline);
+    qint64 readBackend(qint64 offset, char *data, qint64 length);
+    void markBad(qint64 offset, qint64 length);
+    static void fillMarker(qint64 offset, char *data, qint64 length);
+    bool load();
+    void save();
+    QString mapFilePath() const;
+
+    QIODevice *m_backend;
+    EvidenceSource *m_source;
+    qint64 m_size;
+    qint64 m_sectorSize;
+    QString m_evidencePath;
+    QByteArray m_identity; // First sector, tells apart media seen under the same path
+    int m_retryBudgetMs;
+    int m_maxRetries;
+
+    // Runs of bad sectors, first sector -> end sector (exclusive), never overlapping
+    mutable QMutex m_mutex;
+    QMap<qint64, qint64> m_badRuns;
+    bool m_dirty;
+
+    std::once_flag m_mapOnce;
+    QAtomicInt m_mapLoaded;
+};
+
+#endif // ERRORTOLERANTDEVICE_H
@@ -0,0 +1,44 @@
+#ifndef EVIDENCEFILE_H
+#define EVIDENCEFILE_H
+
+#include <QIODevice>
+#include <QString>
+#include "evidencesource.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+// Plain image file read with positional I/O (pread / overlapped ReadFile), so
+// it can be shared between threads. Used when an image can not be mapped.
+class EvidenceFile : public QIODevice, public EvidenceSource
+{
+    Q_OBJECT
+
+public:
+    explicit EvidenceFile(const QString &fileName, QObject *parent = nullptr);
+    ~EvidenceFile();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    qint64 size() const override;
+
+    qint64 mediaSize() const override;
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    QString m_fileName;
+    qint64 m_fileSize;
+
+#ifdef Q_OS_WIN
+    HANDLE m_handle;
+#else
+    int m_fd;
+#endif
+};
+
+#endif // EVIDENCEFILE_H
@@ -0,0 +1,65 @@
+#ifndef EVIDENCESOURCE_H
+#define EVIDENCESOURCE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+#include "iostatistics.h"
+
+// Stateless, positional read interface implemented by every evidence device.
+// Unlike QIODevice::seek() + read() there is no shared file position, so one
+// source can be used by the UI and by background workers at the same time.
+class EvidenceSource
+{
+public:
+    struct ReadRequest {
+        qint64 offset = 0;
+        qint64 length = 0;
+        char *data = nullptr;
+        qint64 bytesRead = 0; // Filled in by readv(), -1 on error
+    };
+
+    virtual ~EvidenceSource() = default;
+
+    virtual qint64 mediaSize() const = 0;
+
+    // Returns the number of bytes read, 0 past the end of the media and -1 on error.
+    // Must be safe to call from several threads concurrently.
+    virtual qint64 readAt(qint64 offset, char *data, qint64 maxlen) = 0;
+
+    // Non-blocking variant for the GUI thread: only succeeds when the data is
+    // available without touching slow media, otherwise returns -1.
+    virtual qint64 tryReadAt(qint64 offset, char *data, qint64 maxlen);
+
+    // For one pass over the whole media, such as the sparse scan: layers that
+    // keep their own cache read past it instead of filling it. Defaults to readAt().
+    virtual qint64 readUncached(qint64 offset, char *data, qint64 maxlen);
+
+    QByteArray readBytes(qint64 offset, qint64 length);
+
+    // Warms whatever cache sits behind the source, by default by reading and discarding
+    virtual void prefetch(qint64 offset, qint64 length);
+
+    // Scattered reads in one call. Requests are sorted and neighbouring ones are
+    // coalesced into a single backend read. Returns the total number of bytes read.
+    virtual qint64 readv(QList<ReadRequest> &requests);
+
+    // Counters of this layer, shown per tab in the I/O statistics panel
+    IoStatistics &statistics();
+    // Layer this one reads from, null for the device that reads the media
+    virtual EvidenceSource *innerSource() const;
+    // Defaults to the class name of the device
+    virtual QString layerName() const;
+
+protected:
+    // Requests closer than this are merged, the gap is read and thrown away
+    static constexpr qint64 MaxCoalesceGap = 64 * 1024;
+    static constexpr qint64 MaxCoalescedRead = 4 * 1024 * 1024;
+
+    qint64 readFully(qint64 offset, char *data, qint64 length);
+
+    IoStatistics m_statistics;
+};
+
+#endif // EVIDENCESOURCE_H
@@ -2,9 +2,16 @@
 #define EWFDEVICE_H
 
 #include <QIODevice>
+#include <QCache>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
 #include <libewf.h>
+#include "evidencesource.h"
+#include "persistentchunkcache.h"
 
-class EwfDevice : public QIODevice
+class EwfDevice : public QIODevice, public EvidenceSource
 {
     Q_OBJECT
 
@@ -14,16 +21,62 @@ public:
     ~EwfDevice();
 
     qint64 size() const override;
+    qint64 chunkSize() const;
+    qint64 mediaSize() const override;
 
+    // Thread-safe positional read. Chunk cache misses are decompressed with a
+    // handle checked out of the pool, so worker threads never share the seek
+    // state of the handle used by the QIODevice interface (the hex view).
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+    // Decompresses every chunk without looking it up in or adding it to either cache
+    qint64 readUncached(qint64 offset, char *data, qint64 maxlen) override;
+    void setMaxPooledHandles(int count);
+
+    // Keeps decompressed chunks in a local cache file so that reopening the
+    // evidence does not decompress visited areas again. The file is keyed by the
+    // MD5 and set identifier stored in the image; images without either are not
+    // cached. maxSize bounds all caches in directory together, older caches of
+    // other images are deleted to make room. A size of 0 disables the cache.
+    bool enablePersistentCache(const QString &directory, qint64 maxSize);
+
+    // Time spent in libewf reading and decompressing chunks that missed both
+    // caches, apart from the statistics of readAt() which include cache hits
+    IoStatistics &decompressionStatistics();
 
 protected:
     qint64 readData(char *data, qint64 maxlen) override;
     qint64 writeData(const char *data, qint64 len) override;
 
 private:
+    libewf_handle_t *openHandle();
+    void closeHandle(libewf_handle_t *handle);
+    libewf_handle_t *acquireHandle();
+    void releaseHandle(libewf_handle_t *handle);
+
+    qint64 readChunks(qint64 offset, char *data, qint64 maxlen, libewf_handle_t *handle, bool useCaches = true);
+    QByteArray chunk(qint64 chunkIndex, libewf_handle_t *handle, bool useCaches);
+    bool decompressChunk(libewf_handle_t *handle, qint64 chunkIndex, QByteArray &chunkData);
+    QString evidenceKey();
+
+    QByteArray m_filePath;
     libewf_handle_t *m_ewfHandle;
     size64_t m_mediaSize;
-    size64_t m_fileSize;
+    size32_t m_chunkSize;
+
+    // Decompressed chunks, aligned to the EWF chunk size
+    static const int MaxCachedChunks = 512;
+    QCache<qint64, QByteArray> m_chunkCache;
+    QMutex m_cacheMutex;
+
+    // Independently opened handles for parallel readers
+    QList<libewf_handle_t *> m_idleHandles;
+    int m_pooledHandleCount;
+    int m_maxPooledHandles;
+    QMutex m_poolMutex;
+    QWaitCondition m_handleReleased;
+
+    PersistentChunkCache *m_diskCache;
+    IoStatistics m_decompressionStatistics;
 
     libewf_error_t *m_error;
 };
@@ -6,6 +6,9 @@
 #include <QList>
 #include <QStringList>
 #include <tsk/libtsk.h>
+#include "evidencesource.h"
+
+class CachedDevice;
 
 class FileSystemHandler : public QObject
 {
@@ -16,6 +19,12 @@ public:
     ~FileSystemHandler();
 
     bool openImage(const QString &fileName);
+    // Parses the evidence the hex view already reads, sharing its device and cache
+    bool openEvidence(EvidenceSource *source);
+    // Room TSK reads get in the shared page cache on top of the hex view, applies
+    // to the evidence opened next
+    void setImageCacheSize(qint64 bytes);
+    void closeImage();
     QList<QStringList> listFilesInDirectory(int partitionIndex, const QString &directoryPath);
     int getPartitionCount() const;
     QString getPartitionDescription(uint partitionIndex) const;
@@ -42,8 +51,10 @@ private:
 
     QList<TSK_FS_INFO*> openFileSystems;
     QString formatSize(qint64 size) const;
-    void closeImage();
+    bool openVolumeSystem();
     bool fsOpenedDirectly;
+    qint64 imageCacheSize;
+    CachedDevice *reservedCache; // Page cache already grown for TSK
 };
 
 #endif // FILESYSTEMHANDLER_H
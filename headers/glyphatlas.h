@@ -0,0 +1,55 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <QFont>
+#include <QPixmap>
+#include <QtGlobal>
+
+class QPainter;
+
+// Pre-rendered glyphs of the hex view. The two hex digits of every byte value,
+// the ASCII column character of every byte value and the loading placeholders
+// are drawn once per font, device pixel ratio and ink into one pixmap, so a
+// repaint only copies small rectangles instead of laying out text per byte.
+//
+// Each ink is a band of the pixmap with three 16x16 grids side by side: hex
+// pairs (two characters wide), ASCII cells and the placeholders.
+class GlyphAtlas
+{
+public:
+    enum Ink {
+        Dark,        // On light backgrounds
+        Light,       // On dark backgrounds (selection, dark tags)
+        DarkBold,    // Byte under the cursor
+        LightBold,
+        Placeholder, // Bytes still being loaded
+        Address,     // Offset column and header
+        InkCount
+    };
+
+    GlyphAtlas();
+
+    // Rebuilds the pixmap when the font or the device pixel ratio changed
+    void update(const QFont &font, qreal devicePixelRatio);
+
+    // x and baseline are the text origin QPainter::drawText would be given
+    void drawHexByte(QPainter &painter, int x, int baseline, quint8 value, Ink ink) const;
+    void drawAsciiByte(QPainter &painter, int x, int baseline, quint8 value, Ink ink) const;
+    void drawHexPlaceholder(QPainter &painter, int x, int baseline) const;
+    void drawAsciiPlaceholder(QPainter &painter, int x, int baseline) const;
+    // digits upper-case hex digits, zero padded, digits must be even
+    void drawHexNumber(QPainter &painter, int x, int baseline, quint64 value, int digits, Ink ink) const;
+
+private:
+    void blit(QPainter &painter, int x, int baseline, int sourceX, int sourceY, int columns) const;
+    static QColor inkColor(Ink ink);
+
+    QPixmap m_pixmap;
+    QFont m_font;
+    qreal m_devicePixelRatio;
+    int m_charWidth;   // Logical pixels
+    int m_lineHeight;
+    int m_ascent;
+};
+
+#endif // GLYPHATLAS_H
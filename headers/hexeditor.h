@@ -8,9 +8,21 @@
 #include <QFile>
 #include <QPair>
 #include <QSet>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QAtomicInteger>
+#include <QCache>
+#include <QPixmap>
 #include "tag.h"
 #include "tagshandler.h"
 #include "ewfdevice.h"
+#include "evidencesource.h"
+#include "prefetcher.h"
+#include "sparsemap.h"
+#include "errortolerantdevice.h"
+#include "glyphatlas.h"
+#include "tagindex.h"
+#include "byteselection.h"
 #include "loadingdialog.h"
 
 
@@ -28,7 +40,12 @@ public:
     void setCursorPosition(quint64 position);
     void ensureCursorVisible();
     void clearSelection();
-    QByteArray getSelectedBytes() const;
+    // Selected bytes in file order, read from the evidence and cut at maxLength
+    QByteArray getSelectedBytes(qint64 maxLength) const;
+    // Same bytes without blocking the GUI thread: selectedBytesReady is emitted right
+    // away when the viewport or the page cache holds them, otherwise once they are read
+    void requestSelectedBytes(qint64 maxLength);
+    const ByteSelection &selectedRanges() const;
     quint64 cursorPosition;
     quint64 fileSize;
     void addTag(quint64 offset, quint64 length, const QString &description, const QColor &color, const QString &type);
@@ -42,6 +59,22 @@ public:
     void setTagsHandler(TagsHandler *tagsHandler);
     void setUserTagsHandler(TagsHandler *userTagsHandler);
 
+    void setPageCacheBudget(qint64 bytes);
+    // Size of the on-disk chunk cache of E01 evidence opened afterwards, 0 disables it
+    void setPersistentChunkCacheSize(qint64 bytes);
+    void prefetchAround(quint64 offset);
+    EvidenceSource *evidenceSource() const;
+    void jumpToNextNonEmptyBlock();
+    // Forgets the bad sectors of a drive and reads the view again
+    void retryBadSectors();
+
+    struct IoLayer {
+        QString name;
+        IoStatistics *statistics;
+    };
+    // The view itself first, then every device layer down to the media. The
+    // pointers are valid until the next setData()
+    QList<IoLayer> ioLayers();
 
     enum class SearchType {
         Hex,
@@ -51,6 +84,8 @@ public:
 
     void search(const QString &pattern, SearchType type);
     void nextSearch();
+    // Collects every hit (up to MaxSearchHits) and highlights all of them
+    void searchAll(const QString &pattern, SearchType type);
 
     void clearSearchResults();
 
@@ -59,18 +94,23 @@ public slots:
     void syncTagsOnClose(std::function<void(bool)> callback);
 
 signals:
-    void selectionChanged(const QByteArray &selectedData, quint64 startOffset, quint64 endOffset);
+    // startOffset and endOffset bound the range being selected, selectedLength counts every range
+    void selectionChanged(quint64 startOffset, quint64 endOffset, quint64 selectedLength);
     void tagsUpdated(const QVector<Tag> &tags);
     void tagNameAndLength(const QString &tagName, quint64 length,QString tagColor);
+    void selectedBytesReady(const QByteArray &bytes);
 
 
 protected:
     void paintEvent(QPaintEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
+    void focusInEvent(QFocusEvent *event) override;
+    void focusOutEvent(QFocusEvent *event) override;
     void contextMenuEvent(QContextMenuEvent *event) override;
     void scrollContentsBy(int dx, int dy)override;
 
@@ -81,21 +121,71 @@ private slots:
     void onTagSelectedBytes();
     void onApplyTags(QString category);
     void onShowTags(const QString &tagCategory);
+    void onVerticalScrollAction(int action);
+    void onViewportDataLoaded();
+    void onJumpDataLoaded();
+    void onSelectedBytesLoaded();
 
 
 private:
     void updateScrollbar();
     void updateSelection(const QPoint &pos, bool reset);
+    // Invalidate only the cells of the given file bytes that are on screen
+    void updateByteRange(quint64 first, quint64 last);
+    void updateSelectionArea(const ByteSelection &ranges);
+    void emitSelectionChanged();
     quint64 calculateOffset(const QPoint &pos);
-    void drawAddressArea(QPainter &painter, quint64 startLine, int horizontalOffset);
-    void drawHexArea(QPainter &painter, quint64 startLine, int horizontalOffset);
-    void drawAsciiArea(QPainter &painter, quint64 startLine, int horizontalOffset);
+    // Rows firstRow to lastRow of the viewport are drawn, startLine is the top line
+    void drawAddressArea(QPainter &painter, quint64 startLine, int horizontalOffset, int firstRow, int lastRow);
+    void drawHexArea(QPainter &painter, quint64 startLine, int horizontalOffset, int firstRow, int lastRow);
+    void drawAsciiArea(QPainter &painter, quint64 startLine, int horizontalOffset, int firstRow, int lastRow);
     void drawHeader(QPainter &painter, int horizontalOffset);
+    void drawSeparators(QPainter &painter, int horizontalOffset);
     void drawCursor(QPainter &painter);
+    GlyphAtlas glyphAtlas; // Rebuilt by paintEvent() when the font or screen changes
+
+    // Rendered rows by line, drawn by paintEvent() at the horizontal offset. An entry
+    // is reused while its bytes per line, generation and cursor column still match
+    struct RowRaster {
+        QPixmap pixmap;
+        quint64 bytesPerLine;
+        quint64 generation;
+        int cursorColumn; // -1 when the cursor is on another row
+    };
+    // Screens of rows kept, the visible one plus one for scrolling back and forth
+    static constexpr int RowCacheScreens = 2;
+    // Cells are highlighted this far below their row, see drawHexArea()
+    static constexpr int HighlightOffsetY = 3;
+    QCache<quint64, RowRaster> rowCache; // Cost in KB
+    quint64 rowGeneration = 0; // Bumped when tags, hits or bad sectors change
+    QFont rowCacheFont;
+    qreal rowCacheDevicePixelRatio = 0;
+    void invalidateRows();
+    // Selection changes only drop the rows holding the bytes that changed
+    void invalidateRows(quint64 first, quint64 last);
+    void invalidateRows(const ByteSelection &ranges);
+    int rowRasterHeight() const;
+    void updateRowCacheBudget();
+    bool isRowLoaded(quint64 line) const;
+    const QPixmap *rowPixmap(quint64 line, int row);
+    // Moves the pixels of the rows still on screen after topLine changed
+    void scrollRows(quint64 previousTopLine);
     void updateVisibleData();
 
+    // 64-bit virtual scrolling, topLine is the first line shown in the viewport
+    static constexpr int MaxScrollbarValue = 1 << 30;
+    // Largest selection copied to the clipboard as hex text
+    static constexpr qint64 MaxCopyBytes = 16 * 1024 * 1024;
+    quint64 totalLines() const;
+    quint64 maxTopLine() const;
+    int visibleLineCount() const;
+    int scrollValueForLine(quint64 line) const;
+    quint64 lineForScrollValue(int value) const;
+    void scrollToLine(quint64 line);
+    void scrollByLines(qint64 delta);
+
     quint64 bytesPerLine;
-    QPair<quint64, quint64> selection;
+    QPair<quint64, quint64> selection; // Anchor and active end as file offsets, -1 when nothing is selected
     bool isDragging;
     bool cursorVisible;
     int charWidth;
@@ -114,15 +204,17 @@ private:
     //QFile file;
     quint64 visibleStart;
     quint64 visibleEnd;
-    QSet<quint64> selectedOffsets;
-    QSet<quint64> highligtedOffsets;
+    ByteSelection selectionRanges;
+    ByteSelection committedRanges; // Kept while Ctrl+drag adds another range
 
     quint64 cursorByteOffset;
 
 
 
     QList<Tag> tags;
+    TagIndex tagIndex; // Invalidated whenever tags changes
     QIODevice *device = nullptr;
+    EvidenceSource *source = nullptr; // Positional read interface of device
 
     quint64 startBlockOffset;
     bool startBlockSelected;
@@ -134,8 +226,13 @@ private:
     TagsHandler *userTagsHandler;
 
 
+    // Hits found so far as [start, end], sorted by start. They all have the
+    // pattern length, so their ends are sorted as well
     QList<QPair<quint64, quint64>> searchResults;
     int currentSearchIndex;
+    static constexpr int MaxSearchHits = 100000;
+    // Part of a mapped image searched between two checks that the file still backs it
+    static constexpr qint64 MappedSearchSlice = 64 * 1024 * 1024;
     QString currentSearchPattern;
     SearchType currentSearchType;
 
@@ -145,12 +242,57 @@ private:
     void searchInHexFromPosition(const QByteArray &pattern, quint64 startPosition);
     void searchInAsciiFromPosition(const QString &pattern, quint64 startPosition);
     void searchInUtf16FromPosition(const QString &pattern, quint64 startPosition);
+    bool searchMappedFromPosition(const QByteArray &pattern, quint64 startPosition, int maxHits = 1);
+    bool searchSourceFromPosition(const QByteArray &pattern, quint64 startPosition, int maxHits = 1);
+    QByteArray searchPatternBytes() const;
+    void showSearchHit(int index);
+    QList<QPair<quint64, quint64>> searchHitsIn(quint64 from, quint64 to) const;
+    EvidenceSource *scanSource() const;
 
     QString file_name;
 
     int currentTabIndex;
     LoadingDialog *loadingDialog;
 
+    qint64 pageCacheBudget;
+    qint64 persistentChunkCacheSize;
+
+    quint64 topLine;
+    bool syncingScrollbar;
+    int wheelRemainder;
+
+    // Viewport reads run on a dedicated I/O thread. Bytes of data_visible outside
+    // [loadedFrom, loadedTo) are still being loaded and drawn as placeholders.
+    struct ViewportData {
+        quint64 generation = 0;
+        quint64 start = 0;
+        QByteArray data;
+    };
+    void requestViewportData(quint64 start, qint64 length);
+    bool isByteLoaded(quint64 index) const;
+
+    // Drives are read through an ErrorTolerantDevice, the bad sectors it found
+    // in the viewport are collected once per paint and drawn distinctly
+    ErrorTolerantDevice *errorTolerantDevice = nullptr;
+    QList<QPair<qint64, qint64>> visibleBadRanges;
+    void attachErrorTolerantDevice(ErrorTolerantDevice *tolerantDevice);
+    bool isInBadSector(quint64 pos) const;
+
+    // Declared before ioPool, which waits for running reads when destroyed
+    QAtomicInteger<quint64> loadGeneration;
+    IoStatistics viewStatistics; // Viewport reads, from request to delivery
+    QThreadPool ioPool;
+    QFutureWatcher<ViewportData> viewportWatcher;
+    QFutureWatcher<ViewportData> jumpWatcher; // Block read for jumpToNextNonEmptyBlock
+    quint64 jumpRequest = 0;
+    QFutureWatcher<ViewportData> selectionWatcher; // Read for requestSelectedBytes
+    quint64 selectionRequest = 0;
+    bool readWithoutWaiting(quint64 offset, qint64 length, char *data);
+    qint64 loadedFrom;
+    qint64 loadedTo;
+
+    Prefetcher *prefetcher;
+    SparseMap *sparseMap;
 
 };
 
@@ -68,6 +68,7 @@ private slots:
 
     void onOpenSearchForm();
     void onSearchButtonClicked();
+    void onFindAllButtonClicked();
     void onSearchNextButtonClicked();
     void onSaveButtonClicked();
 
@@ -100,6 +101,7 @@ private:
     void onTemplateTagTableDoubleClicked(const QModelIndex &index);
 
      searchform *searchForm;
+    HexEditor::SearchType selectedSearchType() const;
     TagsHandler *tagsHandler;
      TagsHandler *userTagsHandler;
 
@@ -0,0 +1,68 @@
+#ifndef IOSTATISTICS_H
+#define IOSTATISTICS_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+// Lock-free read counters of one device or cache layer. Every counter is a
+// separate atomic so the hot read paths never take a lock, the statistics
+// panel copies them into a Snapshot and computes rates from the difference.
+class IoStatistics
+{
+public:
+    // Bucket i counts reads of 2^(i-1) up to 2^i microseconds, bucket 0 faster ones
+    static constexpr int LatencyBuckets = 32;
+
+    struct Snapshot {
+        quint64 reads = 0;
+        quint64 bytesRead = 0;
+        quint64 errors = 0;
+        quint64 cacheHits = 0;
+        quint64 cacheMisses = 0;
+        qint64 outstanding = 0;
+        quint64 latency[LatencyBuckets] = {};
+
+        // Share of lookups served from the cache, -1 for layers without a cache
+        double hitRatio() const;
+        // Upper bound in microseconds of the bucket holding the percentile (0-100)
+        quint64 latencyPercentile(double percentile) const;
+    };
+
+    // Measures one read from construction until finish()
+    class ReadTimer
+    {
+    public:
+        explicit ReadTimer(IoStatistics &statistics);
+        // Returns bytesRead so a read can end with return timer.finish(...)
+        qint64 finish(qint64 bytesRead);
+
+    private:
+        IoStatistics &m_statistics;
+        QElapsedTimer m_timer;
+    };
+
+    IoStatistics();
+
+    // A negative bytesRead counts as an error
+    void recordRead(qint64 bytesRead, qint64 nanoseconds);
+    void recordCacheHit(quint64 count = 1);
+    void recordCacheMiss(quint64 count = 1);
+    void beginAsync();
+    void endAsync();
+
+    Snapshot snapshot() const;
+
+private:
+    QAtomicInteger<quint64> m_reads;
+    QAtomicInteger<quint64> m_bytesRead;
+    QAtomicInteger<quint64> m_errors;
+    QAtomicInteger<quint64> m_cacheHits;
+    QAtomicInteger<quint64> m_cacheMisses;
+    QAtomicInteger<qint64> m_outstanding;
+    QAtomicInteger<quint64> m_latency[LatencyBuckets];
+
+    Q_DISABLE_COPY(IoStatistics)
+};
+
+#endif // IOSTATISTICS_H
@@ -0,0 +1,45 @@
+#ifndef IOSTATISTICSPANEL_H
+#define IOSTATISTICSPANEL_H
+
+#include <QWidget>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include "hexeditor.h"
+#include "iostatistics.h"
+
+class QTableWidget;
+
+// Live view of the I/O statistics of the current tab, one row per layer from
+// the hex view down to the media. Throughput is the difference between two
+// refreshes, latencies are the percentiles since the evidence was opened.
+class IoStatisticsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int RefreshIntervalMs = 1000;
+
+    explicit IoStatisticsPanel(QWidget *parent = nullptr);
+
+    void setHexEditor(HexEditor *editor);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    void refresh();
+    static QString formatLatency(quint64 microseconds);
+
+    QPointer<HexEditor> m_editor;
+    QTableWidget *m_table;
+    QTimer m_refreshTimer;
+
+    // Previous snapshot per layer, for the throughput column
+    QHash<QString, IoStatistics::Snapshot> m_previous;
+    QElapsedTimer m_sinceRefresh;
+};
+
+#endif // IOSTATISTICSPANEL_H
@@ -5,6 +5,7 @@
 #include "datatypeviewmodel.h"
 #include "filesystemhandler.h"
 #include "tagshandler.h"
+#include "iostatisticspanel.h"
 
 
 QT_BEGIN_NAMESPACE
@@ -28,8 +29,10 @@ private slots:
     void openFile();
     void onEndianCheckboxStateChanged(quint64 state);
     void onTabChanged(int index);
-    void onSelectionChanged(const QByteArray &selectedData, quint64 startOffset, quint64 endOffset);
+    void onSelectionChanged(quint64 startOffset, quint64 endOffset, quint64 selectedLength);
+    void onSelectedBytesReady(const QByteArray &bytes);
     void onTagNameAndLength(const QString &tagName, quint64 length,QString tagColor);
+    void configureChunkCache();
 
 private:
     Ui::MainWindow *ui;
@@ -39,6 +42,9 @@ private:
     void on_openDiskButton_clicked();
     TagsHandler *tagsHandler;
     TagsHandler *userTagsHandler;
+    IoStatisticsPanel *ioStatisticsPanel;
+    // Disk space for decompressed E01 chunks of all images together, 0 when off
+    qint64 chunkCacheSize() const;
 
 
 protected:
@@ -0,0 +1,68 @@
+#ifndef MAPPEDIMAGEDEVICE_H
+#define MAPPEDIMAGEDEVICE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QMutex>
+#include "evidencesource.h"
+
+// Memory-mapped, read-only device for raw/dd images. On 64-bit builds the whole
+// image is mapped once and span() hands out pointers into it without copying.
+// When the address space is constrained a sliding window is mapped instead.
+class MappedImageDevice : public QIODevice, public EvidenceSource
+{
+    Q_OBJECT
+
+public:
+    enum AccessPattern {
+        RandomAccess,     // Interactive viewing, no read-ahead
+        SequentialAccess  // Search and scans, aggressive read-ahead
+    };
+
+    explicit MappedImageDevice(const QString &fileName, QObject *parent = nullptr);
+    ~MappedImageDevice();
+
+    // A read through a mapping of a file whose backing store fails or goes away
+    // raises SIGBUS instead of returning an error, so only regular files on fixed,
+    // local media are mapped. Anything else is left to the pread based EvidenceFile.
+    static bool canMapSafely(const QString &fileName);
+
+    bool openMapped(OpenMode mode);
+    qint64 size() const override;
+
+    qint64 mediaSize() const override;
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+    qint64 tryReadAt(qint64 offset, char *data, qint64 maxlen) override;
+    void prefetch(qint64 offset, qint64 length) override;
+
+    // Returns a read-only view of [offset, offset + length) or nullptr if the range
+    // can not be mapped. In sliding window mode the pointer stays valid only until
+    // the next call to span() or read().
+    const uchar *span(qint64 offset, qint64 length);
+    bool isFullyMapped() const;
+
+    void setAccessPattern(AccessPattern pattern);
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    bool mapWindow(qint64 offset, qint64 length);
+    bool isBacked(qint64 offset, qint64 length);
+    qint64 backedSize() const;
+    void adviseWindow();
+
+    QFile m_file;
+    qint64 m_fileSize;
+    qint64 m_windowLength;
+
+    uchar *m_window;
+    qint64 m_windowStart;
+    qint64 m_windowSize;
+
+    AccessPattern m_accessPattern;
+    QMutex m_mutex;
+};
+
+#endif // MAPPEDIMAGEDEVICE_H
@@ -0,0 +1,72 @@
+#ifndef PERSISTENTCHUNKCACHE_H
+#define PERSISTENTCHUNKCACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// On-disk cache of decompressed evidence chunks that survives restarts. Chunks
+// are stored in fixed-size slots of one data file, an index file maps chunk
+// numbers to slots and keeps their LRU order. Every chunk carries a checksum
+// that is verified when it is read back, so a stale index or a torn write only
+// costs a cache miss.
+class PersistentChunkCache
+{
+public:
+    static constexpr qint64 DefaultMaxSize = 1024LL * 1024 * 1024;
+
+    // key identifies the evidence (for E01 its stored MD5 and set GUID)
+    PersistentChunkCache(const QString &directory, const QString &key, qint64 chunkSize, qint64 maxSize = DefaultMaxSize);
+    ~PersistentChunkCache();
+
+    bool open();
+
+    // Thread-safe. read() returns false on a miss or when verification fails.
+    bool read(qint64 chunkIndex, QByteArray &data);
+    void write(qint64 chunkIndex, const QByteArray &data);
+    void flush();
+
+    static QString defaultDirectory();
+    // Deletes the least recently written caches in directory, other than the one
+    // of keepKey, until the others take at most maxSize bytes
+    static void trimDirectory(const QString &directory, qint64 maxSize, const QString &keepKey);
+
+private:
+    struct Slot {
+        qint64 chunkIndex = -1;
+        quint32 length = 0;
+        quint64 checksum = 0;
+        int prev = -1; // More recently used
+        int next = -1; // Less recently used
+    };
+
+    static quint64 checksum(const char *data, qint64 length);
+
+    // Callers hold m_mutex
+    void unlink(int slot);
+    void pushFront(int slot);
+    int takeSlot();
+    void dropSlot(int slot);
+    bool loadIndex();
+    bool saveIndex();
+
+    QString m_dataPath;
+    QString m_indexPath;
+    qint64 m_chunkSize;
+    int m_slotCount;
+
+    QFile m_dataFile;
+    QVector<Slot> m_slots;
+    QHash<qint64, int> m_lookup;
+    QVector<int> m_freeSlots;
+    int m_nextUnused;
+    int m_head; // Most recently used
+    int m_tail; // Least recently used, replaced first
+    int m_writesSinceSave;
+    QMutex m_mutex;
+};
+
+#endif // PERSISTENTCHUNKCACHE_H
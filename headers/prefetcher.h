@@ -0,0 +1,58 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <QMutex>
+#include "evidencesource.h"
+
+// Read-ahead for the hex view. Tracks the direction and speed of viewport moves
+// and warms the blocks ahead of the viewport on a background thread. The block
+// size adapts to the measured latency of the source: slow media (network shares,
+// USB docks) get fewer, larger requests.
+class Prefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 MinBlockSize = 64 * 1024;
+    static constexpr qint64 MaxBlockSize = 8 * 1024 * 1024;
+
+    explicit Prefetcher(QObject *parent = nullptr);
+    ~Prefetcher();
+
+    // Cancels pending work and waits for the block in flight before switching
+    void setSource(EvidenceSource *source);
+
+    void viewportMoved(quint64 start, quint64 length);
+    void prefetchAround(quint64 offset);
+
+    void setMaxBlocksAhead(int blocks);
+    qint64 blockSize() const;
+
+private:
+    void schedule(quint64 from, quint64 to);
+    void prefetchBlock(quint64 generation, quint64 blockStart, qint64 length);
+    void adaptBlockSize(qint64 length, qint64 elapsedMs);
+
+    EvidenceSource *m_source;
+    qint64 m_mediaSize;
+
+    QThreadPool m_pool;
+    QAtomicInteger<quint64> m_generation;
+
+    // Viewport history, GUI thread only
+    QElapsedTimer m_moveTimer;
+    quint64 m_lastStart;
+    int m_direction;
+    quint64 m_prefetchedFrom;
+    quint64 m_prefetchedTo;
+    int m_maxBlocksAhead;
+
+    mutable QMutex m_blockSizeMutex;
+    qint64 m_blockSize;
+};
+
+#endif // PREFETCHER_H
@@ -18,6 +18,7 @@ public:
     QString getSearchPattern() const;
     QString getSearchType() const;
     QPushButton* getSearchButton() const;
+    QPushButton* getFindAllButton() const;
 
 private:
     Ui::searchform *ui;
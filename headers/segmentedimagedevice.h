@@ -0,0 +1,60 @@
+#ifndef SEGMENTEDIMAGEDEVICE_H
+#define SEGMENTEDIMAGEDEVICE_H
+
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include "evidencesource.h"
+#include "evidencefile.h"
+
+// Split raw image (image.001, image.002, ...) presented as one device. Segment
+// offsets are indexed for binary search and only a bounded number of segment
+// files is kept open at a time, least recently used ones are closed first.
+class SegmentedImageDevice : public QIODevice, public EvidenceSource
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultMaxOpenSegments = 16;
+
+    explicit SegmentedImageDevice(const QString &firstSegmentPath, QObject *parent = nullptr);
+    ~SegmentedImageDevice();
+
+    // True for names ending in a numeric extension such as .001
+    static bool isSegmentedImagePath(const QString &filePath);
+
+    bool open(OpenMode mode) override;
+    qint64 size() const override;
+
+    qint64 mediaSize() const override;
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+
+    int segmentCount() const;
+    QStringList segmentPaths() const;
+    void setMaxOpenSegments(int count);
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    bool discoverSegments();
+    int segmentForOffset(qint64 offset) const;
+    QSharedPointer<EvidenceFile> segmentFile(int segment);
+
+    QString m_firstSegmentPath;
+    QStringList m_segmentPaths;
+    // m_segmentStarts[i] is the image offset of segment i, the last entry is the total size
+    QList<qint64> m_segmentStarts;
+
+    QMutex m_poolMutex;
+    QHash<int, QSharedPointer<EvidenceFile>> m_openSegments;
+    QList<int> m_recentSegments; // Least recently used first
+    int m_maxOpenSegments;
+};
+
+#endif // SEGMENTEDIMAGEDEVICE_H
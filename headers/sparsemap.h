@@ -0,0 +1,85 @@
+#ifndef SPARSEMAP_H
+#define SPARSEMAP_H
+
+#include <QObject>
+#include <QVector>
+#include <QThreadPool>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QString>
+#include "evidencesource.h"
+
+// Map of the all-zero blocks of an evidence item, built by a background scan and
+// saved per evidence so reopening a case does not scan again. Search, navigation
+// and the scrollbar use it to skip the empty parts of sparse images.
+//
+// One bit per block, plus a summary bit per 64 blocks so that finding the next
+// empty or non-empty block only touches a few words even on multi-TB media.
+// Blocks that have not been scanned yet count as non-empty.
+class SparseMap : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 BlockSize = 64 * 1024;
+
+    explicit SparseMap(QObject *parent = nullptr);
+    ~SparseMap();
+
+    // Loads the saved map of the evidence at path, then scans whatever is still
+    // unknown. The source must stay valid until stop() returns.
+    void start(EvidenceSource *source, const QString &path);
+    // Cancels the scan, saves its progress and forgets the map
+    void stop();
+
+    bool isEmptyBlock(qint64 offset) const;
+    // Whether the block of offset has been read, unscanned blocks count as data
+    bool isScanned(qint64 offset) const;
+    // True until the scan started by start() has visited every block
+    bool isScanning() const;
+    // Returns offset itself when its block has data, otherwise the start of the
+    // next block with data, or the media size when there is none
+    qint64 nextNonEmpty(qint64 offset) const;
+    // Returns offset itself when its block is empty, otherwise the start of the
+    // next empty block, or the media size when there is none
+    qint64 nextEmpty(qint64 offset) const;
+    bool hasEmptyBlocks() const;
+
+    // Share of empty blocks (0-255) in each of buckets equal slices of the media
+    QVector<quint8> emptyProfile(int buckets) const;
+
+    static bool isZeroBlock(const char *data, qint64 length);
+
+signals:
+    // Emitted from the scan thread as more blocks are marked
+    void updated();
+
+private:
+    void scan(quint64 generation);
+    void markWord(qint64 word, quint64 emptyBits, quint64 scannedBits);
+    void updateSummary(qint64 word);
+    qint64 findBlock(qint64 block, bool empty) const;
+    qint64 countEmpty(qint64 firstBlock, qint64 endBlock) const;
+    bool load();
+    void save();
+    QString mapFilePath() const;
+
+    EvidenceSource *m_source;
+    QString m_path;
+    qint64 m_mediaSize;
+    qint64 m_blockCount;
+
+    QThreadPool m_pool;
+    QAtomicInteger<quint64> m_generation;
+    QAtomicInt m_scanning;
+    bool m_dirty;
+
+    // Guarded by m_mutex, written by the scan thread
+    mutable QMutex m_mutex;
+    QVector<quint64> m_empty;      // Bit per block
+    QVector<quint64> m_scanned;    // Bit per block
+    QVector<quint64> m_fullWords;  // Bit per word of m_empty with all 64 blocks empty
+    QVector<quint64> m_anyWords;   // Bit per word of m_empty with at least one empty block
+};
+
+#endif // SPARSEMAP_H
@@ -0,0 +1,26 @@
+#ifndef SPARSESCROLLBAR_H
+#define SPARSESCROLLBAR_H
+
+#include <QScrollBar>
+#include <QPointer>
+#include "sparsemap.h"
+
+// Vertical scrollbar of the hex view that shades the empty regions of the
+// evidence along its groove, so data areas can be spotted and dragged to.
+class SparseScrollBar : public QScrollBar
+{
+    Q_OBJECT
+
+public:
+    explicit SparseScrollBar(QWidget *parent = nullptr);
+
+    void setSparseMap(SparseMap *map);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QPointer<SparseMap> m_map;
+};
+
+#endif // SPARSESCROLLBAR_H
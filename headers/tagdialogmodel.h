@@ -7,20 +7,22 @@
 #include <QStandardItemModel>
 #include <QFile>
 #include "tag.h"
+#include "evidencesource.h"
 
 class TagDialogModel : public QDialog
 {
     Q_OBJECT
 
 public:
-    explicit TagDialogModel(const QString &title, const QList<Tag> &tags, QIODevice &file, quint64 currentCursorPos, QWidget *parent = nullptr,const QMap<QString, QList<Tag>> &tagsListByGroup= QMap<QString, QList<Tag>>());
+    explicit TagDialogModel(const QString &title, const QList<Tag> &tags, EvidenceSource &file, quint64 currentCursorPos, QWidget *parent = nullptr,const QMap<QString, QList<Tag>> &tagsListByGroup= QMap<QString, QList<Tag>>());
 
 private:
     QTableView *tableView;
     QTabWidget *tabWidget;
     QStandardItemModel *model;
-    void populateModel(const QList<Tag> &tags, QIODevice &file);
-    void populateModelByGroup(const QMap<QString, QList<Tag>> &tagsListByGroup, QIODevice &file);
+    void populateModel(const QList<Tag> &tags, EvidenceSource &file);
+    void populateModelByGroup(const QMap<QString, QList<Tag>> &tagsListByGroup, EvidenceSource &file);
+    QList<QByteArray> readTagData(const QList<Tag> &tags, EvidenceSource &file);
 
     quint64 currentCursorPos;
 
@@ -0,0 +1,51 @@
+#ifndef TAGINDEX_H
+#define TAGINDEX_H
+
+#include <QColor>
+#include <QList>
+#include <QVector>
+#include "tag.h"
+
+// Interval index over the tags of a hex view. The tags are sorted by start and
+// treated as an implicit balanced tree (the root of every range is its middle
+// element) where each node keeps the largest end of its subtree, so finding
+// the tags overlapping a range is O(log n + matches) whatever the tag count.
+//
+// Where tags overlap, the one that comes first in the tag list wins, as it did
+// when the list was scanned in order. Colours are parsed once per rebuild.
+class TagIndex
+{
+public:
+    struct Span {
+        quint64 start;
+        quint64 end; // Exclusive
+        QColor color;
+        int tagIndex; // Position in the tag list
+    };
+
+    // Marks the index stale, the next ensure() rebuilds it
+    void invalidate();
+    void ensure(const QList<Tag> &tags);
+
+    // Index in the tag list of the tag shown at offset, -1 when there is none
+    int tagAt(quint64 offset) const;
+    // Tagged parts of [from, to) in order, each with the colour of the winning tag
+    QVector<Span> spans(quint64 from, quint64 to) const;
+
+private:
+    struct Entry {
+        quint64 start;
+        quint64 end;
+        QColor color;
+        int tagIndex;
+    };
+
+    quint64 buildMaxEnd(int low, int high);
+    void collect(int low, int high, quint64 from, quint64 to, QVector<int> &found) const;
+
+    QVector<Entry> m_entries;  // Sorted by start
+    QVector<quint64> m_maxEnd; // Largest end in the subtree rooted at each entry
+    bool m_dirty = true;
+};
+
+#endif // TAGINDEX_H
@@ -0,0 +1,27 @@
+#ifndef VHDIDEVICE_H
+#define VHDIDEVICE_H
+
+#include "chunkedimagedevice.h"
+#include <libvhdi.h>
+
+// Guest disk of a VHD or VHDX image read with libvhdi
+class VhdiDevice : public ChunkedImageDevice
+{
+    Q_OBJECT
+
+public:
+    // Default block size of dynamic VHD images
+    static constexpr qint64 BlockSize = 2 * 1024 * 1024;
+
+    explicit VhdiDevice(QObject *parent = nullptr);
+    bool openVhdi(const char *vhdFilePath, OpenMode mode);
+    ~VhdiDevice();
+
+protected:
+    bool readChunkFromImage(qint64 offset, char *data, qint64 length) override;
+
+private:
+    libvhdi_file_t *m_vhdiFile;
+};
+
+#endif // VHDIDEVICE_H
@@ -0,0 +1,27 @@
+#ifndef VMDKDEVICE_H
+#define VMDKDEVICE_H
+
+#include "chunkedimagedevice.h"
+#include <libvmdk.h>
+
+// Guest disk of a VMware VMDK (descriptor plus extent files) read with libvmdk
+class VmdkDevice : public ChunkedImageDevice
+{
+    Q_OBJECT
+
+public:
+    // Default grain size of sparse extents (128 sectors)
+    static constexpr qint64 GrainSize = 64 * 1024;
+
+    explicit VmdkDevice(QObject *parent = nullptr);
+    bool openVmdk(const char *vmdkFilePath, OpenMode mode);
+    ~VmdkDevice();
+
+protected:
+    bool readChunkFromImage(qint64 offset, char *data, qint64 length) override;
+
+private:
+    libvmdk_handle_t *m_vmdkHandle;
+};
+
+#endif // VMDKDEVICE_H
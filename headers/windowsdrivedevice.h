@@ -1,11 +1,13 @@
 #ifndef WINDOWSDRIVEDEVICE_H
 #define WINDOWSDRIVEDEVICE_H
-#include <windows.h>
-
 
 #include <QIODevice>
+#include "evidencesource.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
 
-class WindowsDriveDevice : public QIODevice
+class WindowsDriveDevice : public QIODevice, public EvidenceSource
 {
     Q_OBJECT
 
@@ -15,6 +17,12 @@ public:
 
     qint64 size() const override;
 
+    qint64 mediaSize() const override;
+    qint64 readAt(qint64 offset, char *data, qint64 maxlen) override;
+
+    // Reads must start and end on this boundary, callers buffer through
+    // BufferedEvidenceDevice rather than reading sector by sector
+    qint64 sectorSize() const;
 
 protected:
     qint64 readData(char *data, qint64 maxlen) override;
@@ -23,11 +31,9 @@ protected:
 private:
     HANDLE hDevice;
     qint64 m_fileSize;
-    QByteArray buffer;
-    qint64 bufferStartPos;
-    qint64 bufferEndPos;
-
-    bool fillBuffer(qint64 position);
+    qint64 m_sectorSize;
 };
 
+#endif // Q_OS_WIN
+
 #endif // WINDOWSDRIVEDEVICE_H
@@ -17,20 +17,38 @@
 
 #include <QTextStream>
 #include <QFileDialog>
+#ifdef Q_OS_WIN
 #include <windows.h>
 #include "headers/windowsdrivedevice.h"
+#endif
+#include "headers/blockdevice.h"
+#include "headers/cacheddevice.h"
+#include "headers/bufferedevidencedevice.h"
+#include "headers/errortolerantdevice.h"
+#include "headers/mappedimagedevice.h"
+#include "headers/evidencefile.h"
+#include "headers/segmentedimagedevice.h"
+#include "headers/vmdkdevice.h"
+#include "headers/vhdidevice.h"
+#include "headers/sparsescrollbar.h"
 #include <algorithm>
-#include <fstream>
+#include <functional>
 #include <iterator>
 #include <vector>
 #include <QMessageBox>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QtConcurrent>
+#include <QWheelEvent>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <climits>
+#include <cmath>
 
 HexEditor::HexEditor(QWidget *parent)
     : QAbstractScrollArea(parent),
     cursorPosition(0),
+    fileSize(0),
     bytesPerLine(16),  // Initialize selection as invalid
     selection(qMakePair(-1, -1)),  // Initialize dragging flag
     isDragging(false),
@@ -46,7 +64,17 @@ HexEditor::HexEditor(QWidget *parent)
     currentTabIndex(0),
     currentSearchIndex(-1),
     loadingDialog(new LoadingDialog(this)),
-    file_name("")
+    file_name(""),
+    pageCacheBudget(CachedDevice::DefaultMemoryBudget),
+    persistentChunkCacheSize(0),
+    topLine(0),
+    syncingScrollbar(false),
+    wheelRemainder(0),
+    loadGeneration(0),
+    loadedFrom(0),
+    loadedTo(0),
+    prefetcher(new Prefetcher(this)),
+    sparseMap(new SparseMap(this))
 {
 
 
@@ -62,12 +90,24 @@ HexEditor::HexEditor(QWidget *parent)
     hexAreaWidth = charWidth * 3 * bytesPerLine;
     asciiAreaWidth = charWidth * bytesPerLine;
 
+    SparseScrollBar *scrollBar = new SparseScrollBar(this);
+    scrollBar->setSparseMap(sparseMap);
+    setVerticalScrollBar(scrollBar);
+
     updateScrollbar();
 
-    // Initialize cursor blink timer
+    // Wheel, arrow and page steps move by exact lines even when the scrollbar is scaled
+    connect(verticalScrollBar(), &QScrollBar::actionTriggered, this, &HexEditor::onVerticalScrollAction);
+
+    // One I/O thread keeps viewport reads in order and off the GUI thread
+    ioPool.setMaxThreadCount(1);
+    connect(&viewportWatcher, &QFutureWatcher<ViewportData>::finished, this, &HexEditor::onViewportDataLoaded);
+    connect(&jumpWatcher, &QFutureWatcher<ViewportData>::finished, this, &HexEditor::onJumpDataLoaded);
+    connect(&selectionWatcher, &QFutureWatcher<ViewportData>::finished, this, &HexEditor::onSelectedBytesLoaded);
+
+    // Initialize cursor blink timer, it only runs while the editor has focus
     cursorBlinkTimer.setInterval(500);
     connect(&cursorBlinkTimer, &QTimer::timeout, this, &HexEditor::updateCursorBlink);
-    cursorBlinkTimer.start();
 
 
 
@@ -96,9 +136,26 @@ void HexEditor::setData(const QString &filePath,int tabIndex)
     file_name=filePath;
     currentTabIndex=tabIndex;
     QFileInfo fileInfo(filePath);
+    // Drop queued viewport reads and wait for the one in flight before the device goes away
+    loadGeneration.fetchAndAddOrdered(1);
+    ioPool.waitForDone();
+    ++jumpRequest; // A pending jump belongs to the previous image
+    prefetcher->setSource(nullptr);
+    sparseMap->stop();
+
+    data_visible.clear(); // May point into the mapping of the previous device
+    loadedFrom = 0;
+    loadedTo = 0;
+    errorTolerantDevice = nullptr;
+    visibleBadRanges.clear();
     delete device; // Clean up any previously used device
+    device = nullptr;
+    source = nullptr;
+
+    QIODevice *backend = nullptr;
 
     // Check if the filePath represents a physical drive
+#ifdef Q_OS_WIN
     if (filePath.startsWith("\\\\.\\PhysicalDrive")) {
 
         qDebug() << "Opening to  Windows drive device.";
@@ -108,48 +165,106 @@ void HexEditor::setData(const QString &filePath,int tabIndex)
         if (!driveDevice->open(QIODevice::ReadOnly)) {
             qDebug() << "Failed to open Windows drive device.";
             delete driveDevice;
-            device = nullptr;
             return;
         }
-        device = driveDevice;
-        fileSize = device->size();
-        qDebug() << "Windows device file size:" << fileSize;
-
-
-
-
-
-    } else if (fileInfo.suffix().toUpper() == "E01") {
+        const qint64 sectorSize = driveDevice->sectorSize();
+        ErrorTolerantDevice *tolerantDrive = new ErrorTolerantDevice(driveDevice, sectorSize, filePath, this);
+        tolerantDrive->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        attachErrorTolerantDevice(tolerantDrive);
+        // The drive only accepts sector aligned reads, the buffer turns the
+        // view's small unaligned reads into whole blocks
+        BufferedEvidenceDevice *bufferedDrive = new BufferedEvidenceDevice(
+            tolerantDrive, BufferedEvidenceDevice::Policy::interactive(sectorSize), this);
+        bufferedDrive->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        backend = bufferedDrive;
+        qDebug() << "Windows device file size:" << backend->size();
+    } else
+#elif defined(Q_OS_LINUX)
+    if (filePath.startsWith("/dev/")) {
+        BlockDevice *blockDevice = new BlockDevice(filePath, this);
+        if (!blockDevice->open(QIODevice::ReadOnly)) {
+            qDebug() << "Failed to open block device.";
+            delete blockDevice;
+            return;
+        }
+        ErrorTolerantDevice *tolerantDevice = new ErrorTolerantDevice(blockDevice, blockDevice->sectorSize(), filePath, this);
+        tolerantDevice->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        attachErrorTolerantDevice(tolerantDevice);
+        backend = tolerantDevice;
+        qDebug() << "Block device size:" << backend->size();
+    } else
+#endif
+    if (fileInfo.suffix().toUpper() == "E01") {
         EwfDevice *ewfDevice = new EwfDevice(this);
         if (!ewfDevice->openEwf(filePath.toStdString().c_str(), QIODevice::ReadOnly)) {
             qDebug() << "Failed to open EWF device.";
             delete ewfDevice;
-            device = nullptr;
             return;
         }
-        device = ewfDevice;
-        fileSize = device->size(); // This should work for EWF files
-        qDebug() << "EWF file size:" << fileSize;
-    } else {
-        // Handle regular file
-        device = new QFile(filePath, this);
-        if (!device->open(QIODevice::ReadOnly)) {
-            qDebug() << "Failed to open file.";
-            delete device;
-            device = nullptr;
+        ewfDevice->enablePersistentCache(PersistentChunkCache::defaultDirectory(), persistentChunkCacheSize);
+        backend = ewfDevice;
+        qDebug() << "EWF file size:" << backend->size();
+    } else if (fileInfo.suffix().toUpper() == "VMDK") {
+        VmdkDevice *vmdkDevice = new VmdkDevice(this);
+        if (!vmdkDevice->openVmdk(QFile::encodeName(filePath).constData(), QIODevice::ReadOnly)) {
+            qDebug() << "Failed to open VMDK device.";
+            delete vmdkDevice;
             return;
         }
-        fileSize = device->size();
-        qDebug() << "Regular file size:" << fileSize;
+        backend = vmdkDevice;
+        qDebug() << "VMDK guest disk size:" << backend->size();
+    } else if (fileInfo.suffix().toUpper() == "VHD" || fileInfo.suffix().toUpper() == "VHDX") {
+        VhdiDevice *vhdiDevice = new VhdiDevice(this);
+        if (!vhdiDevice->openVhdi(QFile::encodeName(filePath).constData(), QIODevice::ReadOnly)) {
+            qDebug() << "Failed to open VHD device.";
+            delete vhdiDevice;
+            return;
+        }
+        backend = vhdiDevice;
+        qDebug() << "VHD guest disk size:" << backend->size();
+    } else if (SegmentedImageDevice::isSegmentedImagePath(filePath)) {
+        SegmentedImageDevice *segmentedDevice = new SegmentedImageDevice(filePath, this);
+        if (!segmentedDevice->open(QIODevice::ReadOnly)) {
+            qDebug() << "Failed to open segmented image.";
+            delete segmentedDevice;
+            return;
+        }
+        backend = segmentedDevice;
+        qDebug() << "Segmented image size:" << backend->size() << "in" << segmentedDevice->segmentCount() << "segments";
+    } else {
+        // Raw images are memory mapped, the OS page cache already caches them
+        MappedImageDevice *mappedDevice = new MappedImageDevice(filePath, this);
+        if (mappedDevice->openMapped(QIODevice::ReadOnly)) {
+            device = mappedDevice;
+            qDebug() << "Mapped file size:" << device->size();
+        } else {
+            delete mappedDevice;
+
+            // Handle regular file
+            backend = new EvidenceFile(filePath, this);
+            if (!backend->open(QIODevice::ReadOnly)) {
+                qDebug() << "Failed to open file.";
+                delete backend;
+                return;
+            }
+            qDebug() << "Regular file size:" << backend->size();
+        }
     }
 
-    //File Size is Limited to 32GB due to limits for data structues
-    qint64 maxFileSizeLimit=32212254720 ;
-    if(fileSize >maxFileSizeLimit){
-        fileSize= maxFileSizeLimit;
+    if (backend) {
+        // All reads (repaint, tag dialogs, tag export) go through the shared page cache
+        CachedDevice *cachedDevice = new CachedDevice(backend, CachedDevice::DefaultPageSize, this);
+        cachedDevice->setMemoryBudget(pageCacheBudget);
+        cachedDevice->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        device = cachedDevice;
     }
+    source = dynamic_cast<EvidenceSource *>(device);
+    prefetcher->setSource(source);
+    sparseMap->start(scanSource(), filePath);
+    fileSize = device->size();
 
     m_data.clear();
+    topLine = 0;
 
     updateScrollbar();
     updateVisibleData();
@@ -157,7 +272,10 @@ void HexEditor::setData(const QString &filePath,int tabIndex)
     // Reset selection
     selection.first = -1;
     selection.second = -1;
-    selectedOffsets.clear();
+    selectionRanges.clear();
+    committedRanges.clear();
+    rowCache.clear();
+    invalidateRows();
 
 
     //Set saved tags from disk
@@ -175,6 +293,127 @@ void HexEditor::setData(const QString &filePath,int tabIndex)
     viewport()->update();
 }
 
+void HexEditor::setPageCacheBudget(qint64 bytes)
+{
+    pageCacheBudget = bytes;
+
+    CachedDevice *cachedDevice = qobject_cast<CachedDevice *>(device);
+    if (cachedDevice) {
+        cachedDevice->setMemoryBudget(bytes);
+    }
+}
+
+void HexEditor::setPersistentChunkCacheSize(qint64 bytes)
+{
+    persistentChunkCacheSize = bytes;
+}
+
+EvidenceSource *HexEditor::evidenceSource() const
+{
+    return source;
+}
+
+QList<HexEditor::IoLayer> HexEditor::ioLayers()
+{
+    QList<IoLayer> layers;
+    layers.append({tr("View"), &viewStatistics});
+    for (EvidenceSource *layer = source; layer; layer = layer->innerSource()) {
+        layers.append({layer->layerName(), &layer->statistics()});
+        if (EwfDevice *ewfDevice = dynamic_cast<EwfDevice *>(layer)) {
+            layers.append({tr("EWF decompression"), &ewfDevice->decompressionStatistics()});
+        }
+    }
+    return layers;
+}
+
+// Moves the cursor past the empty region at or after it, to the first non-zero byte
+void HexEditor::jumpToNextNonEmptyBlock()
+{
+    if (!source) {
+        return;
+    }
+
+    const QString title = tr("Jump to Next Non-Empty Block");
+    const qint64 emptyStart = sparseMap->nextEmpty(cursorPosition);
+    if (emptyStart >= static_cast<qint64>(fileSize)) {
+        if (sparseMap->isScanning()) {
+            QMessageBox::information(this, title, tr("The scan for empty blocks is still running and has not found any after the cursor yet."));
+        } else {
+            QMessageBox::information(this, title, tr("No empty blocks found after the cursor."));
+        }
+        return;
+    }
+    const qint64 target = sparseMap->nextNonEmpty(emptyStart);
+    if (target >= static_cast<qint64>(fileSize)) {
+        QMessageBox::information(this, title, tr("Only empty blocks follow the cursor."));
+        return;
+    }
+    // Unscanned blocks count as data, the empty region may go on past them
+    if (sparseMap->isScanning() && !sparseMap->isScanned(target)) {
+        QMessageBox::information(this, title, tr("The scan for empty blocks has not reached the end of this empty region yet."));
+        return;
+    }
+
+    // The first non-zero byte is looked for once the block is read on the I/O thread
+    const quint64 request = ++jumpRequest;
+    EvidenceSource *readSource = source;
+    QFuture<ViewportData> future = QtConcurrent::run(&ioPool, [=]() {
+        ViewportData result;
+        result.generation = request;
+        result.start = target;
+        result.data = readSource->readBytes(target, SparseMap::BlockSize);
+        return result;
+    });
+    jumpWatcher.setFuture(future);
+}
+
+void HexEditor::onJumpDataLoaded()
+{
+    const ViewportData result = jumpWatcher.result();
+    if (result.generation != jumpRequest) {
+        return;
+    }
+
+    quint64 offset = result.start;
+    for (qint64 i = 0; i < result.data.size(); ++i) {
+        if (result.data.at(i) != 0) {
+            offset = result.start + i;
+            break;
+        }
+    }
+    setSelectedByte(offset);
+}
+
+void HexEditor::retryBadSectors()
+{
+    if (!errorTolerantDevice) {
+        return;
+    }
+    errorTolerantDevice->clearBadSectors();
+
+    // Every layer above the drive may still hold the marker bytes
+    for (EvidenceSource *layer = source; layer && layer != errorTolerantDevice; layer = layer->innerSource()) {
+        if (CachedDevice *cachedDevice = dynamic_cast<CachedDevice *>(layer)) {
+            cachedDevice->clearCache();
+        } else if (BufferedEvidenceDevice *bufferedDevice = dynamic_cast<BufferedEvidenceDevice *>(layer)) {
+            bufferedDevice->clearBuffer();
+        }
+    }
+
+    data_visible.clear();
+    loadedFrom = 0;
+    loadedTo = 0;
+    updateVisibleData();
+    invalidateRows();
+    viewport()->update();
+}
+
+// Warms the data around a jump target, e.g. a marker or tag about to be opened
+void HexEditor::prefetchAround(quint64 offset)
+{
+    prefetcher->prefetchAround(offset);
+}
+
 QByteArray HexEditor::getData() const
 {
     return m_data;
@@ -182,20 +421,56 @@ QByteArray HexEditor::getData() const
 
 void HexEditor::paintEvent(QPaintEvent *event)
 {
-    Q_UNUSED(event);
-
     QPainter painter(viewport());
     painter.setFont(font());
+    const qreal devicePixelRatio = viewport()->devicePixelRatioF();
+    glyphAtlas.update(font(), devicePixelRatio);
+    tagIndex.ensure(tags);
+
+    // Cached rows hold the glyphs of the font and screen they were rendered for
+    if (font() != rowCacheFont || !qFuzzyCompare(devicePixelRatio, rowCacheDevicePixelRatio)) {
+        rowCacheFont = font();
+        rowCacheDevicePixelRatio = devicePixelRatio;
+        rowCache.clear();
+    }
+    updateRowCacheBudget();
 
-    quint64 firstLine = verticalScrollBar()->value();
+    visibleBadRanges.clear();
+    if (errorTolerantDevice && !data_visible.isEmpty()) {
+        visibleBadRanges = errorTolerantDevice->badRanges(visibleStart, data_visible.size());
+    }
+
+    quint64 firstLine = topLine;
     int horizontalOffset = horizontalScrollBar()->value();
 
-    drawHeader(painter, horizontalOffset);
+    // Only the rows under the invalidated rectangle are drawn, a cursor blink repaints
+    // one cell. One row of margin covers highlights and the underline reaching into
+    // the neighbouring rows
+    const QRect dirty = event->rect();
+    const int firstRow = qMax(0, (dirty.top() - headerHeight) / charHeight - 1);
+    const int lastRow = qMax(0, (dirty.bottom() - headerHeight) / charHeight + 1);
+
+    if (dirty.top() <= headerHeight) {
+        drawHeader(painter, horizontalOffset);
+    }
 
+    // Rows are drawn top to bottom like before, so what one row draws below its band
+    // is still covered by the next one
+    const int lastDrawnRow = qMin(lastRow, visibleLineCount());
+    for (int row = firstRow; row <= lastDrawnRow; ++row) {
+        const quint64 line = firstLine + row;
+        if (line * bytesPerLine >= fileSize) break;
 
-    drawAddressArea(painter, firstLine, horizontalOffset);
-    drawHexArea(painter, firstLine, horizontalOffset);
-    drawAsciiArea(painter, firstLine, horizontalOffset);
+        const QPixmap *pixmap = rowPixmap(line, row);
+        if (pixmap) {
+            painter.drawPixmap(-horizontalOffset, headerHeight + row * charHeight, *pixmap);
+        } else {
+            drawAddressArea(painter, firstLine, horizontalOffset, row, row);
+            drawHexArea(painter, firstLine, horizontalOffset, row, row);
+            drawAsciiArea(painter, firstLine, horizontalOffset, row, row);
+        }
+    }
+    drawSeparators(painter, horizontalOffset);
     drawCursor(painter);
 
 
@@ -211,16 +486,64 @@ void HexEditor::resizeEvent(QResizeEvent *event)
 
 void HexEditor::keyPressEvent(QKeyEvent *event)
 {
-    Q_UNUSED(event);
-    // Implement key press handling if needed
+    switch (event->key()) {
+    case Qt::Key_Up:
+        scrollByLines(-1);
+        break;
+    case Qt::Key_Down:
+        scrollByLines(1);
+        break;
+    case Qt::Key_PageUp:
+        scrollByLines(-static_cast<qint64>(visibleLineCount()));
+        break;
+    case Qt::Key_PageDown:
+        scrollByLines(visibleLineCount());
+        break;
+    case Qt::Key_Home:
+        if (event->modifiers() & Qt::ControlModifier) {
+            scrollToLine(0);
+        }
+        break;
+    case Qt::Key_End:
+        if (event->modifiers() & Qt::ControlModifier) {
+            scrollToLine(maxTopLine());
+        }
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+    }
+}
+
+void HexEditor::wheelEvent(QWheelEvent *event)
+{
+    const QPoint angleDelta = event->angleDelta();
+    if (qAbs(angleDelta.x()) > qAbs(angleDelta.y())) {
+        QAbstractScrollArea::wheelEvent(event);
+        return;
+    }
+
+    // Accumulate high resolution deltas until a full notch (120) is reached
+    wheelRemainder += angleDelta.y();
+    const int notches = wheelRemainder / 120;
+    wheelRemainder %= 120;
+
+    if (notches != 0) {
+        scrollByLines(-static_cast<qint64>(notches) * QApplication::wheelScrollLines());
+    }
+    event->accept();
 }
 
 void HexEditor::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton) {
         isDragging = true;
-        updateSelection(event->pos(), true);
-        cursorPosition = selection.second + visibleStart; // Update cursor position with respect to the file
+        // Shift extends the current range, Ctrl keeps the selected ranges and starts another one
+        const bool extend = (event->modifiers() & Qt::ShiftModifier) && selection.first != static_cast<quint64>(-1);
+        if (!extend) {
+            committedRanges = (event->modifiers() & Qt::ControlModifier) ? selectionRanges : ByteSelection();
+        }
+        updateSelection(event->pos(), !extend);
+        cursorPosition = selection.second; // Update cursor position with respect to the file
     }
 }
 
@@ -228,7 +551,7 @@ void HexEditor::mouseMoveEvent(QMouseEvent *event)
 {
     if (isDragging && (event->buttons() & Qt::LeftButton)) {
         updateSelection(event->pos(), false);
-        cursorPosition = selection.second + visibleStart; // Update cursor position with respect to the file
+        cursorPosition = selection.second; // Update cursor position with respect to the file
     }
 }
 
@@ -237,24 +560,44 @@ void HexEditor::mouseReleaseEvent(QMouseEvent *event)
     if (event->button() == Qt::LeftButton) {
         isDragging = false;
         updateSelection(event->pos(), false);
-        cursorPosition = selection.second + visibleStart; // Update cursor position with respect to the file
+        cursorPosition = selection.second; // Update cursor position with respect to the file
+    }
+}
+
+void HexEditor::focusInEvent(QFocusEvent *event)
+{
+    QAbstractScrollArea::focusInEvent(event);
+    cursorBlinkState = true;
+    cursorBlinkTimer.start();
+    updateByteRange(cursorPosition, cursorPosition);
+}
+
+// An unfocused editor shows a steady cursor and does not wake up to blink it
+void HexEditor::focusOutEvent(QFocusEvent *event)
+{
+    QAbstractScrollArea::focusOutEvent(event);
+    cursorBlinkTimer.stop();
+    if (!cursorBlinkState) {
+        cursorBlinkState = true;
+        updateByteRange(cursorPosition, cursorPosition);
     }
 }
 
 void HexEditor::updateScrollbar()
 {
-    // Calculate total lines
-    quint64 lines = (fileSize + bytesPerLine - 1) / bytesPerLine;
+    // QScrollBar is int based, so the 64-bit line index is mapped onto at most
+    // MaxScrollbarValue steps. Only thumb dragging uses that (coarse) mapping.
+    quint64 maxLine = maxTopLine();
+    topLine = qMin(topLine, maxLine);
 
-    //qDebug() << "Total lines:" << lines << "File size:" << fileSize << "Bytes per line:" << bytesPerLine;
+    //qDebug() << "Max top line:" << maxLine << "File size:" << fileSize << "Bytes per line:" << bytesPerLine;
 
-    //Max scrollbar value that can be set
-    if(lines >2147483647){
-        lines=2147483647;
-    }
     // Set vertical scrollbar range and page step
-    verticalScrollBar()->setRange(0, lines-1 );
-    verticalScrollBar()->setPageStep((viewport()->height() - headerHeight) / charHeight);
+    syncingScrollbar = true;
+    verticalScrollBar()->setRange(0, static_cast<int>(qMin<quint64>(maxLine, MaxScrollbarValue)));
+    verticalScrollBar()->setPageStep(visibleLineCount());
+    verticalScrollBar()->setValue(scrollValueForLine(topLine));
+    syncingScrollbar = false;
 
     // Calculate content width
     int contentWidth = addressAreaWidth + hexAreaWidth + asciiAreaWidth;
@@ -268,22 +611,256 @@ void HexEditor::updateScrollbar()
 }
 
 
+quint64 HexEditor::totalLines() const
+{
+    return (fileSize + bytesPerLine - 1) / bytesPerLine;
+}
+
+quint64 HexEditor::maxTopLine() const
+{
+    quint64 lines = totalLines();
+    return lines > 0 ? lines - 1 : 0;
+}
+
+int HexEditor::visibleLineCount() const
+{
+    return qMax(0, (viewport()->height() - headerHeight) / charHeight);
+}
+
+int HexEditor::scrollValueForLine(quint64 line) const
+{
+    quint64 maxLine = maxTopLine();
+    if (maxLine <= MaxScrollbarValue) {
+        return static_cast<int>(qMin(line, maxLine));
+    }
+    if (line >= maxLine) {
+        return MaxScrollbarValue;
+    }
+    return static_cast<int>(static_cast<double>(line) * MaxScrollbarValue / maxLine);
+}
+
+quint64 HexEditor::lineForScrollValue(int value) const
+{
+    quint64 maxLine = maxTopLine();
+    if (maxLine <= MaxScrollbarValue) {
+        return static_cast<quint64>(qMax(0, value));
+    }
+    if (value >= MaxScrollbarValue) {
+        return maxLine;
+    }
+    // Rounded up so that scrollValueForLine() maps the result back onto the same value
+    return static_cast<quint64>(std::ceil(static_cast<double>(qMax(0, value)) * maxLine / MaxScrollbarValue));
+}
+
+void HexEditor::scrollToLine(quint64 line)
+{
+    const quint64 previousTopLine = topLine;
+    topLine = qMin(line, maxTopLine());
+
+    syncingScrollbar = true;
+    verticalScrollBar()->setValue(scrollValueForLine(topLine));
+    syncingScrollbar = false;
+
+    updateVisibleData();
+    scrollRows(previousTopLine);
+}
+
+// A step of a few lines shifts the pixels and only the exposed rows are painted
+void HexEditor::scrollRows(quint64 previousTopLine)
+{
+    if (topLine == previousTopLine) {
+        return;
+    }
+
+    const quint64 distance = topLine > previousTopLine ? topLine - previousTopLine : previousTopLine - topLine;
+    if (distance > static_cast<quint64>(visibleLineCount())) {
+        viewport()->update();
+        return;
+    }
+
+    const int dy = static_cast<int>(distance) * charHeight;
+    const QRect rowsArea(0, headerHeight, viewport()->width(), viewport()->height() - headerHeight);
+    viewport()->scroll(0, topLine > previousTopLine ? -dy : dy, rowsArea);
+}
+
+void HexEditor::scrollByLines(qint64 delta)
+{
+    if (delta < 0) {
+        quint64 up = static_cast<quint64>(-delta);
+        scrollToLine(up > topLine ? 0 : topLine - up);
+    } else {
+        scrollToLine(topLine + static_cast<quint64>(delta));
+    }
+}
+
+void HexEditor::onVerticalScrollAction(int action)
+{
+    qint64 delta = 0;
+    switch (action) {
+    case QAbstractSlider::SliderSingleStepAdd:
+        delta = 1;
+        break;
+    case QAbstractSlider::SliderSingleStepSub:
+        delta = -1;
+        break;
+    case QAbstractSlider::SliderPageStepAdd:
+        delta = visibleLineCount();
+        break;
+    case QAbstractSlider::SliderPageStepSub:
+        delta = -static_cast<qint64>(visibleLineCount());
+        break;
+    default:
+        return; // Thumb drags are handled in scrollContentsBy
+    }
+
+    scrollByLines(delta);
+
+    // Keep the pending slider move from overriding the exact line we just set
+    verticalScrollBar()->setSliderPosition(verticalScrollBar()->value());
+}
+
 void HexEditor::updateVisibleData()
 {
+    if (!source) {
+        return;
+    }
 
-    quint64 firstLine = verticalScrollBar()->value();
+    const quint64 previousStart = visibleStart;
+    quint64 firstLine = topLine;
     quint64 linesVisible = (viewport()->height() - headerHeight) / charHeight;
 
     visibleStart = firstLine * bytesPerLine;
-    visibleEnd = qMin(fileSize, visibleStart + linesVisible * bytesPerLine);
+    visibleEnd = qMax(visibleStart, qMin(fileSize, visibleStart + linesVisible * bytesPerLine));
+    const qint64 length = visibleEnd - visibleStart;
+
+    // Any read still queued for the previous window is stale from now on
+    loadGeneration.fetchAndAddOrdered(1);
+    prefetcher->viewportMoved(visibleStart, length);
+
+    // Fully mapped images are rendered straight from the mapping without a copy
+    MappedImageDevice *mappedDevice = qobject_cast<MappedImageDevice *>(device);
+    if (mappedDevice && mappedDevice->isFullyMapped()) {
+        const uchar *visibleBytes = mappedDevice->span(visibleStart, length);
+        if (visibleBytes) {
+            data_visible = QByteArray::fromRawData(reinterpret_cast<const char *>(visibleBytes), length);
+            loadedFrom = 0;
+            loadedTo = length;
+            return;
+        }
+    }
 
+    // Keep the bytes of the previous window that are still visible
+    QByteArray window(length, '\0');
+    const qint64 keepFrom = qMax<qint64>(previousStart + loadedFrom, visibleStart);
+    const qint64 keepTo = qMin<qint64>(previousStart + loadedTo, visibleEnd);
+    if (keepFrom < keepTo) {
+        memcpy(window.data() + (keepFrom - visibleStart), data_visible.constData() + (keepFrom - previousStart), keepTo - keepFrom);
+        loadedFrom = keepFrom - visibleStart;
+        loadedTo = keepTo - visibleStart;
+    } else {
+        loadedFrom = 0;
+        loadedTo = 0;
+    }
 
+    if (loadedFrom > 0 || loadedTo < length) {
+        // Cached data is taken right away, everything else goes to the I/O thread
+        if (source->tryReadAt(visibleStart, window.data(), length) == length) {
+            viewStatistics.recordCacheHit();
+            loadedFrom = 0;
+            loadedTo = length;
+        } else {
+            viewStatistics.recordCacheMiss();
+            requestViewportData(visibleStart, length);
+        }
+    }
 
-    device->seek(visibleStart);
-    data_visible = device->read(visibleEnd - visibleStart);
+    // Repainting is left to the caller, scrolling only repaints the exposed rows
+    data_visible = window;
+}
 
+void HexEditor::requestViewportData(quint64 start, qint64 length)
+{
+    const quint64 generation = loadGeneration.loadAcquire();
+    EvidenceSource *readSource = source;
+    QAtomicInteger<quint64> *currentGeneration = &loadGeneration;
+    IoStatistics *statistics = &viewStatistics;
+    QElapsedTimer requested;
+    requested.start();
+    statistics->beginAsync();
+
+    QFuture<ViewportData> future = QtConcurrent::run(&ioPool, [=]() {
+        ViewportData result;
+        result.generation = generation;
+        result.start = start;
+
+        // Superseded while waiting in the queue, e.g. by fast scrolling
+        if (currentGeneration->loadAcquire() != generation) {
+            statistics->endAsync();
+            return result;
+        }
 
-    viewport()->update();
+        result.data = readSource->readBytes(start, length);
+        // Includes the time spent queued behind other reads
+        statistics->recordRead(result.data.isEmpty() ? -1 : result.data.size(), requested.nsecsElapsed());
+        statistics->endAsync();
+        return result;
+    });
+
+    viewportWatcher.setFuture(future);
+}
+
+void HexEditor::onViewportDataLoaded()
+{
+    const ViewportData result = viewportWatcher.result();
+    if (result.generation != loadGeneration.loadAcquire() || result.start != visibleStart) {
+        return;
+    }
+
+    if (result.data.isEmpty()) {
+        qDebug() << "Failed to load viewport data at offset" << result.start;
+        return;
+    }
+
+    // A short read keeps the window size, the missing tail stays a placeholder
+    const qint64 length = visibleEnd - visibleStart;
+    const qint64 previousFrom = loadedFrom;
+    const qint64 previousTo = loadedTo;
+    memcpy(data_visible.data(), result.data.constData(), qMin<qint64>(length, result.data.size()));
+    loadedFrom = 0;
+    loadedTo = qMin<qint64>(length, result.data.size());
+
+    // Only the rows that showed placeholders change
+    if (previousFrom > 0) {
+        updateByteRange(visibleStart, visibleStart + previousFrom - 1);
+    }
+    if (previousTo < length) {
+        updateByteRange(visibleStart + previousTo, visibleEnd - 1);
+    }
+}
+
+bool HexEditor::isByteLoaded(quint64 index) const
+{
+    return static_cast<qint64>(index) >= loadedFrom && static_cast<qint64>(index) < loadedTo;
+}
+
+void HexEditor::attachErrorTolerantDevice(ErrorTolerantDevice *tolerantDevice)
+{
+    errorTolerantDevice = tolerantDevice;
+    // Emitted from the I/O thread, repaint once the marked sectors reach the view
+    connect(tolerantDevice, &ErrorTolerantDevice::badSectorsFound, this, [this]() {
+        invalidateRows();
+        viewport()->update();
+    });
+}
+
+bool HexEditor::isInBadSector(quint64 pos) const
+{
+    for (const QPair<qint64, qint64> &range : visibleBadRanges) {
+        if (static_cast<qint64>(pos) >= range.first && static_cast<qint64>(pos) < range.second) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void HexEditor::updateSelection(const QPoint &pos, bool reset)
@@ -293,71 +870,200 @@ void HexEditor::updateSelection(const QPoint &pos, bool reset)
         return;  // Click outside the data range
     }
 
+    const ByteSelection previousRanges = selectionRanges;
+    const quint64 previousEnd = selection.second;
+    const quint64 previousCursor = cursorPosition;
+
+    // The anchor is a file offset, so dragging and scrolling can extend the range past the viewport
+    const quint64 fileOffset = visibleStart + offset;
     if (reset) {
-        selection.first = selection.second = offset;
+        selection.first = selection.second = fileOffset;
     } else {
-        selection.second = offset;
+        selection.second = fileOffset;
     }
 
-    // Update the set of selected offsets
-    selectedOffsets.clear();
-    quint64 selectionStart = qMin(selection.first, selection.second) + visibleStart;
-    quint64 selectionEnd = qMax(selection.first, selection.second) + visibleStart;
-    for (quint64 i = selectionStart; i <= selectionEnd; ++i) {
-        selectedOffsets.insert(i);
-    }
+    selectionRanges = committedRanges;
+    selectionRanges.addRange(selection.first, selection.second);
 
-    cursorPosition = selection.second + visibleStart; // Update cursor position with respect to the file
-    QByteArray selectedData = data_visible.mid(qMin(selection.first, selection.second),
-                                               qAbs(selection.second - selection.first) + 1);
-    emit selectionChanged(selectedData, selectionStart, selectionEnd);
+    cursorPosition = selection.second; // Update cursor position with respect to the file
+    emitSelectionChanged();
 
     QString tagName = "";
     quint64 tagLength = 0;
     QString tagColor = "";
 
-    for (const Tag &tag : tags) {
-        if (cursorPosition >= tag.offset && cursorPosition < tag.offset + tag.length) {
-            tagName = tag.description;
-            tagLength = tag.length;
-            tagColor = tag.color;
-            break;
-        }
+    tagIndex.ensure(tags);
+    const int tagUnderCursor = tagIndex.tagAt(cursorPosition);
+    if (tagUnderCursor >= 0) {
+        const Tag &tag = tags.at(tagUnderCursor);
+        tagName = tag.description;
+        tagLength = tag.length;
+        tagColor = tag.color;
     }
 
     emit tagNameAndLength(tagName, tagLength, tagColor);
-    viewport()->update();
+
+    // Dragging only changes the bytes between the old and the new end of the range
+    if (reset || previousEnd == static_cast<quint64>(-1)) {
+        invalidateRows(previousRanges);
+        invalidateRows(selectionRanges);
+        updateSelectionArea(previousRanges);
+        updateSelectionArea(selectionRanges);
+    } else {
+        invalidateRows(qMin(previousEnd, selection.second), qMax(previousEnd, selection.second));
+        updateByteRange(qMin(previousEnd, selection.second), qMax(previousEnd, selection.second));
+    }
+    updateByteRange(previousCursor, previousCursor);
+    updateByteRange(cursorPosition, cursorPosition);
+}
+
+void HexEditor::updateByteRange(quint64 first, quint64 last)
+{
+    if (last < first || bytesPerLine == 0) {
+        return;
+    }
+
+    const quint64 firstLine = qMax<quint64>(first / bytesPerLine, topLine);
+    const quint64 lastLine = qMin<quint64>(last / bytesPerLine, topLine + visibleLineCount());
+    if (firstLine > lastLine) {
+        return;
+    }
+
+    // Cells reach a few pixels left of and below their row (highlight offset, cursor underline)
+    const int top = headerHeight + static_cast<int>(firstLine - topLine) * charHeight;
+    const int height = static_cast<int>(lastLine - firstLine + 1) * charHeight + 4;
+    if (firstLine != lastLine) {
+        viewport()->update(0, top, viewport()->width(), height);
+        return;
+    }
+
+    const quint64 lineStart = firstLine * bytesPerLine;
+    const int firstColumn = static_cast<int>(qMax(first, lineStart) - lineStart);
+    const int lastColumn = static_cast<int>(qMin(last, lineStart + bytesPerLine - 1) - lineStart);
+    const int columns = lastColumn - firstColumn + 1;
+    const int horizontalOffset = horizontalScrollBar()->value();
+
+    viewport()->update(addressAreaWidth + firstColumn * 3 * charWidth - horizontalOffset - 4, top,
+                       columns * 3 * charWidth + 4, height);
+    viewport()->update(addressAreaWidth + hexAreaWidth + firstColumn * charWidth - horizontalOffset, top,
+                       columns * charWidth, height);
 }
 
-QByteArray HexEditor::getSelectedBytes() const
+void HexEditor::updateSelectionArea(const ByteSelection &ranges)
+{
+    for (const ByteSelection::Range &range : ranges.rangesIn(visibleStart, visibleEnd)) {
+        updateByteRange(range.start, range.end);
+    }
+}
+
+void HexEditor::emitSelectionChanged()
+{
+    if (selectionRanges.isEmpty()) {
+        emit selectionChanged(cursorPosition, cursorPosition, 0);
+        return;
+    }
+    emit selectionChanged(qMin(selection.first, selection.second), qMax(selection.first, selection.second),
+                          selectionRanges.totalLength());
+}
+
+QByteArray HexEditor::getSelectedBytes(qint64 maxLength) const
 {
     QByteArray selectedBytes;
-    for (quint64 offset : selectedOffsets) {
-        if (offset >= visibleStart && offset < visibleEnd) {
-            selectedBytes.append(data_visible[offset - visibleStart]);
+    if (!source) {
+        return selectedBytes;
+    }
+
+    for (const ByteSelection::Range &range : selectionRanges.ranges()) {
+        const qint64 length = qMin<qint64>(range.end - range.start + 1, maxLength - selectedBytes.size());
+        if (length <= 0) {
+            break;
         }
+        selectedBytes.append(source->readBytes(range.start, length));
     }
     return selectedBytes;
 }
 
+void HexEditor::requestSelectedBytes(qint64 maxLength)
+{
+    const quint64 request = ++selectionRequest;
+    QVector<ByteSelection::Range> ranges;
+    qint64 total = 0;
+    for (const ByteSelection::Range &range : selectionRanges.ranges()) {
+        const qint64 length = qMin<qint64>(range.end - range.start + 1, maxLength - total);
+        if (length <= 0) {
+            break;
+        }
+        ranges.append({range.start, range.start + length - 1});
+        total += length;
+    }
+
+    QByteArray selectedBytes(total, Qt::Uninitialized);
+    bool ready = true;
+    qint64 position = 0;
+    for (const ByteSelection::Range &range : ranges) {
+        const qint64 length = range.end - range.start + 1;
+        if (!readWithoutWaiting(range.start, length, selectedBytes.data() + position)) {
+            ready = false;
+            break;
+        }
+        position += length;
+    }
+    if (ready || !source) {
+        emit selectedBytesReady(ready ? selectedBytes : QByteArray());
+        return;
+    }
+
+    EvidenceSource *readSource = source;
+    QFuture<ViewportData> future = QtConcurrent::run(&ioPool, [=]() {
+        ViewportData result;
+        result.generation = request;
+        for (const ByteSelection::Range &range : ranges) {
+            result.data.append(readSource->readBytes(range.start, range.end - range.start + 1));
+        }
+        return result;
+    });
+    selectionWatcher.setFuture(future);
+}
+
+void HexEditor::onSelectedBytesLoaded()
+{
+    const ViewportData result = selectionWatcher.result();
+    if (result.generation == selectionRequest) {
+        emit selectedBytesReady(result.data);
+    }
+}
+
+// From the loaded viewport, else from whatever cache answers without touching the media
+bool HexEditor::readWithoutWaiting(quint64 offset, qint64 length, char *data)
+{
+    if (offset >= visibleStart && offset + length <= visibleStart + data_visible.size()
+        && isByteLoaded(offset - visibleStart) && isByteLoaded(offset + length - 1 - visibleStart)) {
+        memcpy(data, data_visible.constData() + (offset - visibleStart), length);
+        return true;
+    }
+    return source && source->tryReadAt(offset, data, length) == length;
+}
+
+const ByteSelection &HexEditor::selectedRanges() const
+{
+    return selectionRanges;
+}
+
 void HexEditor::setSelectedBytes(const QByteArray &selectedBytes)
 {
-    if (selectedBytes.isEmpty()) {
-        selection.first = -1;
-        selection.second = -1;
-        selectedOffsets.clear();
-    } else {
-        quint64 startOffset = data_visible.indexOf(selectedBytes);
+    invalidateRows(selectionRanges);
+    selectionRanges.clear();
+    committedRanges.clear();
+    selection.first = -1;
+    selection.second = -1;
+
+    if (!selectedBytes.isEmpty()) {
+        qint64 startOffset = data_visible.indexOf(selectedBytes);
         if (startOffset != -1) {
-            selection.first = startOffset;
-            selection.second = startOffset + selectedBytes.size() - 1;
-            for (quint64 i = selection.first + visibleStart; i <= selection.second + visibleStart; ++i) {
-                selectedOffsets.insert(i);
-            }
-        } else {
-            selection.first = -1;
-            selection.second = -1;
-            selectedOffsets.clear();
+            selection.first = startOffset + visibleStart;
+            selection.second = selection.first + selectedBytes.size() - 1;
+            selectionRanges.addRange(selection.first, selection.second);
+            invalidateRows(selection.first, selection.second);
         }
     }
 
@@ -367,6 +1073,7 @@ void HexEditor::setSelectedBytes(const QByteArray &selectedBytes)
 void HexEditor::setSelectedByte(qint64 offset)
 {
     quint64 unsignedOffset = static_cast<quint64>(offset);
+    invalidateRows(selectionRanges);
    // qDebug() << "Setting selected byte at offset:" << offset << " (unsigned:" << unsignedOffset << ")";
    // qDebug() << "File size:" << fileSize;
 
@@ -374,32 +1081,34 @@ void HexEditor::setSelectedByte(qint64 offset)
        // qDebug() << "Offset is within the file size range.";
         if (unsignedOffset < visibleStart || unsignedOffset >= visibleEnd) {
           //  qDebug() << "Offset is outside the current visible range. Updating vertical scroll value.";
-            verticalScrollBar()->setValue(unsignedOffset / bytesPerLine);
-            updateVisibleData();
+            scrollToLine(unsignedOffset / bytesPerLine);
         } else {
           //  qDebug() << "Offset is within the current visible range.";
         }
 
-        selection.first = unsignedOffset - visibleStart;
+        selection.first = unsignedOffset;
         selection.second = selection.first;
-        selectedOffsets.clear();
-        selectedOffsets.insert(offset);
+        selectionRanges.clear();
+        committedRanges.clear();
+        selectionRanges.addRange(unsignedOffset, unsignedOffset);
+        invalidateRows(unsignedOffset, unsignedOffset);
 
       //  qDebug() << "Selection updated. First:" << selection.first << "Second:" << selection.second;
     } else {
        // qDebug() << "Offset is out of the file size range. Clearing selection.";
         selection.first = -1;
         selection.second = -1;
-        selectedOffsets.clear();
+        selectionRanges.clear();
+        committedRanges.clear();
     }
 
-    cursorPosition = selection.first + visibleStart;
+    cursorPosition = selection.first;
     cursorByteOffset = cursorPosition;
 
     //qDebug() << "Cursor position updated:" << cursorPosition;
 
     viewport()->update();
-    emit selectionChanged(data_visible, selection.first + visibleStart, selection.second + visibleStart);
+    emitSelectionChanged();
 
     //qDebug() << "Emitted selectionChanged signal.";
 }
@@ -414,7 +1123,7 @@ quint64 HexEditor::calculateOffset(const QPoint &pos)
         return -1;  // Click in the header area
     }
 
-    quint64 row = verticalScrollBar()->value() + y / charHeight;
+    quint64 row = topLine + y / charHeight;
     int col;
 
     if (x < addressAreaWidth) {
@@ -430,41 +1139,51 @@ quint64 HexEditor::calculateOffset(const QPoint &pos)
     return row * bytesPerLine + col - visibleStart;
 }
 
-void HexEditor::drawAddressArea(QPainter &painter, quint64 startLine, int horizontalOffset)
+void HexEditor::drawAddressArea(QPainter &painter, quint64 startLine, int horizontalOffset, int firstRow, int lastRow)
 {
-    painter.setPen(Qt::darkMagenta);
-    for (quint64 line = startLine; line < startLine + (viewport()->height() - headerHeight) / charHeight; ++line) {
+    const quint64 endLine = qMin<quint64>(startLine + lastRow + 1, startLine + (viewport()->height() - headerHeight) / charHeight);
+    for (quint64 line = startLine + firstRow; line < endLine; ++line) {
 
         if (line * bytesPerLine >= fileSize) break;
-        QString address = QString("%1").arg(line * bytesPerLine, 16, 16, QChar('0')).toUpper();
-        painter.drawText(-horizontalOffset, headerHeight + (line - startLine + 1) * charHeight, address);
+        glyphAtlas.drawHexNumber(painter, -horizontalOffset, headerHeight + (line - startLine + 1) * charHeight, line * bytesPerLine, 16, GlyphAtlas::Address);
     }
 }
 
-void HexEditor::drawHexArea(QPainter &painter, quint64 startLine, int horizontalOffset)
+void HexEditor::drawHexArea(QPainter &painter, quint64 startLine, int horizontalOffset, int firstRow, int lastRow)
 {
     painter.setPen(Qt::black);
-    QFont originalFont = painter.font();
-    QFont boldFont = originalFont;
-    boldFont.setBold(true);
 
     int linesVisible = (viewport()->height() - headerHeight) / charHeight;
-    quint64 endLine = startLine + linesVisible;
+    quint64 endLine = startLine + qMin(linesVisible, lastRow);
 
 
 
-    for (quint64 line = startLine; line <= endLine; ++line) {
+    for (quint64 line = startLine + firstRow; line <= endLine; ++line) {
         if (line * bytesPerLine >= fileSize) break;
 
+        // Tag colours and selected ranges of the row, walked alongside the bytes
+        const QVector<TagIndex::Span> rowSpans = tagIndex.spans(line * bytesPerLine, (line + 1) * bytesPerLine);
+        auto span = rowSpans.constBegin();
+        const QVector<ByteSelection::Range> rowSelection = selectionRanges.rangesIn(line * bytesPerLine, (line + 1) * bytesPerLine);
+        auto selected = rowSelection.constBegin();
+        const QList<QPair<quint64, quint64>> rowHits = searchHitsIn(line * bytesPerLine, (line + 1) * bytesPerLine);
+        auto hit = rowHits.constBegin();
+
         for (quint64 byte = 0; byte < bytesPerLine; ++byte) {
             quint64 pos = line * bytesPerLine + byte;
             if (pos - visibleStart >= static_cast<quint64>(data_visible.size())) return;
 
             QColor backgroundColor = Qt::white;
 
-            // Check if the position is within the selected offsets first
-            bool isSelected = selectedOffsets.contains(pos);
-            bool isHighlighted = highligtedOffsets.contains(pos);
+            // Check if the position is within the selected ranges first
+            while (selected != rowSelection.constEnd() && selected->end < pos) {
+                ++selected;
+            }
+            bool isSelected = selected != rowSelection.constEnd() && selected->start <= pos;
+            while (hit != rowHits.constEnd() && hit->second < pos) {
+                ++hit;
+            }
+            bool isHighlighted = hit != rowHits.constEnd() && hit->first <= pos;
 
             if (isHighlighted) {
                 backgroundColor = Qt::yellow;
@@ -472,20 +1191,23 @@ void HexEditor::drawHexArea(QPainter &painter, quint64 startLine, int horizontal
 
             if (isSelected) {
                 backgroundColor = Qt::darkBlue;
+            } else if (isInBadSector(pos)) {
+                // Unreadable on the media, the bytes shown are the marker pattern
+                backgroundColor = QColor(255, 150, 150);
             } else {
-                // If not selected, check for tags
-                for (const Tag &tag : tags) {
-                    if (pos >= tag.offset && pos < tag.offset + tag.length) {
-                        backgroundColor = tag.color;
-                        break;
-                    }
+                // If not selected, use the tag span covering the byte
+                while (span != rowSpans.constEnd() && span->end <= pos) {
+                    ++span;
+                }
+                if (span != rowSpans.constEnd() && span->start <= pos) {
+                    backgroundColor = span->color;
                 }
             }
 
            // painter.fillRect(addressAreaWidth + byte * 3 * charWidth - horizontalOffset, headerHeight + (line - startLine) * charHeight, 3 * charWidth, charHeight, backgroundColor);
 
             int x_highlight_offset=-4;
-            int y_highlight_offset=3;
+            int y_highlight_offset=HighlightOffsetY;
 
             painter.fillRect(
                 addressAreaWidth + byte * 3 * charWidth - horizontalOffset + x_highlight_offset,  // Adjust x-position
@@ -497,56 +1219,182 @@ void HexEditor::drawHexArea(QPainter &painter, quint64 startLine, int horizontal
 
 
 
-            // Set the font color based on the background color's brightness
-            int brightness = (backgroundColor.red() * 299 + backgroundColor.green() * 587 + backgroundColor.blue() * 114) / 1000;
-            QColor fontColor = (brightness > 128) ? Qt::black : Qt::white;
-            painter.setPen(fontColor);
+            const int textX = addressAreaWidth + byte * 3 * charWidth - horizontalOffset;
+            const int baseline = headerHeight + (line - startLine + 1) * charHeight;
 
+            // Placeholder until the I/O thread delivers this part of the viewport
+            if (!isByteLoaded(pos - visibleStart)) {
+                glyphAtlas.drawHexPlaceholder(painter, textX, baseline);
+                continue;
+            }
+
+            // Dark or light glyphs depending on the background brightness, bold under the cursor
+            int brightness = (backgroundColor.red() * 299 + backgroundColor.green() * 587 + backgroundColor.blue() * 114) / 1000;
+            GlyphAtlas::Ink ink;
             if (pos == cursorPosition) {
-                painter.setFont(boldFont); // Set bold font for cursor position
+                ink = (brightness > 128) ? GlyphAtlas::DarkBold : GlyphAtlas::LightBold;
             } else {
-                painter.setFont(originalFont); // Set original font for other positions
+                ink = (brightness > 128) ? GlyphAtlas::Dark : GlyphAtlas::Light;
             }
-
-            QString hex = QString("%1").arg((unsigned char)data_visible[pos - visibleStart], 2, 16, QChar('0')).toUpper();
-            painter.drawText(addressAreaWidth + byte * 3 * charWidth - horizontalOffset, headerHeight + (line - startLine + 1) * charHeight, hex);
+            glyphAtlas.drawHexByte(painter, textX, baseline, static_cast<quint8>(data_visible.at(pos - visibleStart)), ink);
         }
+    }
+
 
+}
+
+// Drawn once over all rows, so cached rows do not carry them
+void HexEditor::drawSeparators(QPainter &painter, int horizontalOffset)
+{
+    if (data_visible.isEmpty()) {
+        return;
+    }
+
+    int totalHeight = headerHeight + (visibleLineCount() + 1) * charHeight; // Ensure total height includes all visible lines
+    painter.setPen(Qt::gray);  // Set pen color for separator
+
+    // Draw vertical lines after every 8 columns
+    for (quint64 i = 8; i < bytesPerLine; i += 8) {
+        int x = addressAreaWidth + i * 3 * charWidth - horizontalOffset;
+        painter.drawLine(x-3, headerHeight, x-3, totalHeight);
+    }
+
+    // Draw vertical line between hex and ASCII areas
+    int separatorX = addressAreaWidth + hexAreaWidth - horizontalOffset-1;
+    painter.drawLine(separatorX-3, headerHeight, separatorX-3, totalHeight);
+}
+
+void HexEditor::invalidateRows()
+{
+    ++rowGeneration;
+}
 
-        int totalHeight = headerHeight + (linesVisible + 1) * charHeight; // Ensure total height includes all visible lines
+// Drops the cached rows holding any byte of [first, last]
+void HexEditor::invalidateRows(quint64 first, quint64 last)
+{
+    if (last < first || bytesPerLine == 0) {
+        return;
+    }
+    const quint64 firstLine = first / bytesPerLine;
+    const quint64 lastLine = last / bytesPerLine;
+    const QList<quint64> lines = rowCache.keys();
+    for (quint64 line : lines) {
+        if (line >= firstLine && line <= lastLine) {
+            rowCache.remove(line);
+        }
+    }
+}
 
-        // Draw vertical lines after every 8 columns
-        for (quint64 i = 8; i < bytesPerLine; i += 8) {
-            int x = addressAreaWidth + i * 3 * charWidth - horizontalOffset;
-            //qDebug() << "Drawing vertical line... i:" << i << "x:" << x << "headerHeight:" << headerHeight << "totalHeight:" << totalHeight;
-            painter.drawLine(x-3, headerHeight, x-3, totalHeight);
+void HexEditor::invalidateRows(const ByteSelection &ranges)
+{
+    if (ranges.isEmpty() || bytesPerLine == 0) {
+        return;
+    }
+    const QList<quint64> lines = rowCache.keys();
+    for (quint64 line : lines) {
+        if (!ranges.rangesIn(line * bytesPerLine, (line + 1) * bytesPerLine).isEmpty()) {
+            rowCache.remove(line);
         }
+    }
+}
+
+// A row paints a few pixels into the next one: hex highlights start HighlightOffsetY
+// below the row top and descenders end below the baseline
+int HexEditor::rowRasterHeight() const
+{
+    return charHeight + qMax(HighlightOffsetY, QFontMetrics(font()).descent());
+}
 
-        // Draw vertical line between hex and ASCII areas
-        int separatorX = addressAreaWidth + hexAreaWidth - horizontalOffset-1;
-        //qDebug() << "Drawing separator line... separatorX:" << separatorX << "headerHeight:" << headerHeight << "totalHeight:" << totalHeight;
-        painter.setPen(Qt::gray);  // Set pen color for separator
-        painter.drawLine(separatorX-3, headerHeight, separatorX-3, totalHeight);
+// Enough for RowCacheScreens screens of rows at the current width, font and screen
+void HexEditor::updateRowCacheBudget()
+{
+    const qreal devicePixelRatio = viewport()->devicePixelRatioF();
+    const qint64 width = std::ceil((addressAreaWidth + hexAreaWidth + asciiAreaWidth) * devicePixelRatio);
+    const qint64 height = std::ceil(rowRasterHeight() * devicePixelRatio);
+    const qint64 rowKb = qMax<qint64>(1, width * height * 4 / 1024);
+    const qint64 budget = rowKb * (visibleLineCount() + 2) * RowCacheScreens;
+    rowCache.setMaxCost(static_cast<int>(qMin<qint64>(budget, INT_MAX)));
+}
+
+// Loaded bytes form one run, so checking both ends of the row is enough
+bool HexEditor::isRowLoaded(quint64 line) const
+{
+    const quint64 lineStart = line * bytesPerLine;
+    if (lineStart < visibleStart) {
+        return false;
     }
+    const quint64 lineEnd = qMin<quint64>(lineStart + bytesPerLine, visibleStart + data_visible.size());
+    return lineStart < lineEnd && isByteLoaded(lineStart - visibleStart) && isByteLoaded(lineEnd - 1 - visibleStart);
+}
 
+// Rows with bytes still loading are not cached, nullptr tells the caller to draw them directly
+const QPixmap *HexEditor::rowPixmap(quint64 line, int row)
+{
+    if (!isRowLoaded(line)) {
+        return nullptr;
+    }
 
+    const quint64 lineStart = line * bytesPerLine;
+    const int cursorColumn = (cursorPosition >= lineStart && cursorPosition < lineStart + bytesPerLine)
+                                 ? static_cast<int>(cursorPosition - lineStart) : -1;
+
+    RowRaster *raster = rowCache.object(line);
+    if (raster && raster->bytesPerLine == bytesPerLine && raster->generation == rowGeneration
+        && raster->cursorColumn == cursorColumn) {
+        return &raster->pixmap;
+    }
+
+    // One row plus the few pixels it paints into the next one
+    const qreal devicePixelRatio = viewport()->devicePixelRatioF();
+    const int width = addressAreaWidth + hexAreaWidth + asciiAreaWidth;
+    raster = new RowRaster{QPixmap(std::ceil(width * devicePixelRatio), std::ceil(rowRasterHeight() * devicePixelRatio)),
+                           bytesPerLine, rowGeneration, cursorColumn};
+    raster->pixmap.setDevicePixelRatio(devicePixelRatio);
+    raster->pixmap.fill(Qt::transparent);
+
+    QPainter painter(&raster->pixmap);
+    painter.setFont(font());
+    painter.translate(0, -(headerHeight + row * charHeight));
+    drawAddressArea(painter, topLine, 0, row, row);
+    drawHexArea(painter, topLine, 0, row, row);
+    drawAsciiArea(painter, topLine, 0, row, row);
+    painter.end();
+
+    const int cost = qMax(1, raster->pixmap.width() * raster->pixmap.height() * 4 / 1024);
+    if (!rowCache.insert(line, raster, cost)) {
+        return nullptr; // Larger than the whole budget, already deleted
+    }
+    return &rowCache.object(line)->pixmap;
 }
 
-void HexEditor::drawAsciiArea(QPainter &painter, quint64 startLine, int horizontalOffset)
+void HexEditor::drawAsciiArea(QPainter &painter, quint64 startLine, int horizontalOffset, int firstRow, int lastRow)
 {
     int linesVisible = (viewport()->height() - headerHeight) / charHeight;
-    quint64 endLine = startLine + linesVisible;
+    quint64 endLine = startLine + qMin(linesVisible, lastRow);
+
+    for (quint64 line = startLine + firstRow; line <= endLine; ++line) {
+        const QVector<TagIndex::Span> rowSpans = tagIndex.spans(line * bytesPerLine, (line + 1) * bytesPerLine);
+        auto span = rowSpans.constBegin();
+        const QVector<ByteSelection::Range> rowSelection = selectionRanges.rangesIn(line * bytesPerLine, (line + 1) * bytesPerLine);
+        auto selected = rowSelection.constBegin();
+        const QList<QPair<quint64, quint64>> rowHits = searchHitsIn(line * bytesPerLine, (line + 1) * bytesPerLine);
+        auto hit = rowHits.constBegin();
 
-    for (quint64 line = startLine; line <= endLine; ++line) {
         for (quint64 byte = 0; byte < bytesPerLine; ++byte) {
             quint64 pos = line * bytesPerLine + byte;
             if (pos - visibleStart >= static_cast<quint64>(data_visible.size())) return;
 
             QColor backgroundColor = Qt::white;
 
-            // Check if the position is within the selected offsets first
-            bool isSelected = selectedOffsets.contains(pos);
-            bool isHighlighted=highligtedOffsets.contains(pos);
+            // Check if the position is within the selected ranges first
+            while (selected != rowSelection.constEnd() && selected->end < pos) {
+                ++selected;
+            }
+            bool isSelected = selected != rowSelection.constEnd() && selected->start <= pos;
+            while (hit != rowHits.constEnd() && hit->second < pos) {
+                ++hit;
+            }
+            bool isHighlighted = hit != rowHits.constEnd() && hit->first <= pos;
 
             if (isHighlighted) {
                 backgroundColor = Qt::yellow;
@@ -554,27 +1402,33 @@ void HexEditor::drawAsciiArea(QPainter &painter, quint64 startLine, int horizont
 
             if (isSelected) {
                 backgroundColor = Qt::darkBlue;
+            } else if (isInBadSector(pos)) {
+                // Unreadable on the media, the bytes shown are the marker pattern
+                backgroundColor = QColor(255, 150, 150);
             } else {
-                // If not selected, check for tags
-                for (const Tag &tag : tags) {
-                    if (pos >= tag.offset && pos < tag.offset + tag.length) {
-                        backgroundColor = tag.color;
-                        break;
-                    }
+                // If not selected, use the tag span covering the byte
+                while (span != rowSpans.constEnd() && span->end <= pos) {
+                    ++span;
+                }
+                if (span != rowSpans.constEnd() && span->start <= pos) {
+                    backgroundColor = span->color;
                 }
             }
 
             painter.fillRect(addressAreaWidth + hexAreaWidth + byte * charWidth - horizontalOffset, headerHeight + (line - startLine) * charHeight, charWidth, charHeight, backgroundColor);
 
-            // Set the font color based on the background color's brightness
-            int brightness = (backgroundColor.red() * 299 + backgroundColor.green() * 587 + backgroundColor.blue() * 114) / 1000;
-            QColor fontColor = (brightness > 128) ? Qt::black : Qt::white;
-            painter.setPen(fontColor);
+            const int textX = addressAreaWidth + hexAreaWidth + byte * charWidth - horizontalOffset;
+            const int baseline = headerHeight + (line - startLine + 1) * charHeight;
 
-            char ch = data_visible[pos - visibleStart];
-            if ((ch < 32) || (ch > 126)) ch = '.';
+            if (!isByteLoaded(pos - visibleStart)) {
+                glyphAtlas.drawAsciiPlaceholder(painter, textX, baseline);
+                continue;
+            }
 
-            painter.drawText(addressAreaWidth + hexAreaWidth + byte * charWidth - horizontalOffset, headerHeight + (line - startLine + 1) * charHeight, QChar(ch));
+            // Dark or light glyphs depending on the background brightness
+            int brightness = (backgroundColor.red() * 299 + backgroundColor.green() * 587 + backgroundColor.blue() * 114) / 1000;
+            GlyphAtlas::Ink ink = (brightness > 128) ? GlyphAtlas::Dark : GlyphAtlas::Light;
+            glyphAtlas.drawAsciiByte(painter, textX, baseline, static_cast<quint8>(data_visible.at(pos - visibleStart)), ink);
         }
     }
 }
@@ -591,8 +1445,7 @@ void HexEditor::drawHeader(QPainter &painter, int horizontalOffset)
     painter.drawText(-horizontalOffset, charHeight, " Offset");
 
     for (quint64 i = 0; i < bytesPerLine; ++i) {
-        QString hexHeader = QString("%1").arg(i, 2, 16, QChar('0')).toUpper();
-        painter.drawText(addressAreaWidth + i * 3 * charWidth - horizontalOffset, charHeight, hexHeader);
+        glyphAtlas.drawHexByte(painter, addressAreaWidth + i * 3 * charWidth - horizontalOffset, charHeight, static_cast<quint8>(i), GlyphAtlas::Address);
 
         // Draw vertical line after every 8 columns
         if (i > 0 && i % 8 == 0) {
@@ -631,6 +1484,18 @@ void HexEditor::contextMenuEvent(QContextMenuEvent *event)
     contextMenu.addAction(endBlockAction);
     connect(endBlockAction, &QAction::triggered, this, &HexEditor::onEndBlock);
 
+    ////////Jump to Next Non-Empty Block Action////////////
+    QAction *nextNonEmptyAction = new QAction("Jump to Next Non-Empty Block", this);
+    contextMenu.addAction(nextNonEmptyAction);
+    connect(nextNonEmptyAction, &QAction::triggered, this, &HexEditor::jumpToNextNonEmptyBlock);
+
+    ////////Retry Bad Sectors Action////////////
+    if (errorTolerantDevice && errorTolerantDevice->badSectorCount() > 0) {
+        QAction *retryBadSectorsAction = new QAction(tr("Retry Bad Sectors"), this);
+        contextMenu.addAction(retryBadSectorsAction);
+        connect(retryBadSectorsAction, &QAction::triggered, this, &HexEditor::retryBadSectors);
+    }
+
 
     ////////////Show as Menu/////////////////////
 
@@ -887,7 +1752,7 @@ void HexEditor::onShowTags(const QString &tagCategory)
             tagsByGroup.insert("GPT Entry", entrytags);
         }
 
-        TagDialogModel dialog(tagCategory, tags, *device,cursorPosition, this,tagsByGroup);
+        TagDialogModel dialog(tagCategory, tags, *source, cursorPosition, this, tagsByGroup);
         dialog.exec();
     }
 
@@ -898,7 +1763,7 @@ void HexEditor::onShowTags(const QString &tagCategory)
         return;
     }
 
-    TagDialogModel dialog(tagCategory, tags, *device,cursorPosition, this);
+    TagDialogModel dialog(tagCategory, tags, *source, cursorPosition, this);
     dialog.exec();
 }
 
@@ -935,8 +1800,8 @@ void HexEditor::onTagSelectedBytes()
         return;
     }
 
-    quint64 startAddr = qMin(selection.first, selection.second) + visibleStart;
-    quint64 endAddr = qMax(selection.first, selection.second) + visibleStart;
+    quint64 startAddr = qMin(selection.first, selection.second);
+    quint64 endAddr = qMax(selection.first, selection.second);
 
     NewTagDialog dialog(this);
     dialog.setStartAddress(startAddr);
@@ -949,25 +1814,27 @@ void HexEditor::onTagSelectedBytes()
 
 void HexEditor::onCopy()
 {
-    if (selection.first == -1 || selection.second == -1) {
+    if (selectionRanges.isEmpty()) {
         return;
     }
 
-    quint64 start = qMin(selection.first, selection.second);
-    quint64 end = qMax(selection.first, selection.second);
-
-    QString selectedText;
-    for (quint64 i = start; i <= end; ++i) {
-        selectedText.append(QString("%1").arg((unsigned char)data_visible[i], 2, 16, QChar('0')).toUpper()).append(' ');
+    // Three characters of text per byte, huge selections are exported rather than copied
+    if (selectionRanges.totalLength() > static_cast<quint64>(MaxCopyBytes)) {
+        QMessageBox::warning(this, tr("Copy"),
+                             tr("The selection is too large to copy (at most %1 bytes).").arg(MaxCopyBytes));
+        return;
     }
 
+    const QByteArray selectedData = getSelectedBytes(MaxCopyBytes);
     QClipboard *clipboard = QGuiApplication::clipboard();
-    clipboard->setText(selectedText.trimmed());
+    clipboard->setText(QString::fromLatin1(selectedData.toHex(' ').toUpper()));
 }
 
 void HexEditor::changeBytesPerLine(quint64 newBytesPerLine)
 {
+    quint64 firstVisibleOffset = topLine * bytesPerLine;
     bytesPerLine = newBytesPerLine;
+    topLine = firstVisibleOffset / bytesPerLine;
     hexAreaWidth = charWidth * 3 * bytesPerLine;
     asciiAreaWidth = charWidth * bytesPerLine;
     updateScrollbar();
@@ -978,15 +1845,17 @@ void HexEditor::changeBytesPerLine(quint64 newBytesPerLine)
 void HexEditor::updateCursorBlink()
 {
     cursorBlinkState = !cursorBlinkState;
-    viewport()->update();  // Repaint the viewport to update the cursor blink state
+    updateByteRange(cursorPosition, cursorPosition);  // Repaint the cursor cell only
 }
 
 void HexEditor::clearSelection()
 {
+    invalidateRows(selectionRanges);
+    updateSelectionArea(selectionRanges);
     selection.first = -1;
     selection.second = -1;
-    selectedOffsets.clear();
-    viewport()->update();
+    selectionRanges.clear();
+    committedRanges.clear();
 }
 void HexEditor::drawCursor(QPainter &painter)
 {
@@ -998,9 +1867,13 @@ void HexEditor::drawCursor(QPainter &painter)
     quint64 row = cursorPosition / bytesPerLine;
     quint64 col = cursorPosition % bytesPerLine;
 
+    if (row < topLine || row > topLine + visibleLineCount()) {
+        return;  // Cursor is outside the viewport
+    }
+
     // Calculate x and y positions based on row and column
     int x = addressAreaWidth + col * 3 * charWidth - horizontalScrollBar()->value();
-    int y = headerHeight + (row - verticalScrollBar()->value()) * charHeight;
+    int y = headerHeight + (row - topLine) * charHeight;
 
     painter.setPen(QPen(Qt::black, 2)); // Set the pen to black with a bold width
     painter.drawLine(x, y + charHeight + 2, x + charWidth, y + charHeight + 2); // Draw a line below the character
@@ -1012,25 +1885,43 @@ void HexEditor::drawCursor(QPainter &painter)
 
 void HexEditor::setCursorPosition(quint64 position)
 {
+    updateByteRange(cursorPosition, cursorPosition);
     cursorPosition = position;
     cursorByteOffset = position; // Store the cursor byte offset
     clearSelection(); // Clear the selection when the cursor position changes
-    emit selectionChanged(QByteArray(), cursorPosition, cursorPosition); // Emit the signal with an empty QByteArray for selection
-    viewport()->update();
+    emitSelectionChanged(); // Nothing is selected, the offsets are the cursor
+    updateByteRange(cursorPosition, cursorPosition);
 }
 
 
 void HexEditor::ensureCursorVisible()
 {
-    quint64 lines = (cursorPosition / bytesPerLine);
-    verticalScrollBar()->setValue(lines);
+    scrollToLine(cursorPosition / bytesPerLine);
     viewport()->update();
 }
 
 void HexEditor::scrollContentsBy(int dx, int dy)
 {
-    QAbstractScrollArea::scrollContentsBy(dx, dy);
+    if (syncingScrollbar) {
+        return;  // topLine was set explicitly, the caller refreshes the data and the pixels
+    }
+
+    // Header and rows move sideways together, only the exposed columns are painted
+    if (dx != 0) {
+        viewport()->scroll(dx, 0);
+    }
+    if (dy == 0) {
+        return;
+    }
+
+    // A thumb drag only gives a coarse position on large images
+    const quint64 previousTopLine = topLine;
+    int value = verticalScrollBar()->value();
+    if (scrollValueForLine(topLine) != value) {
+        topLine = lineForScrollValue(value);
+    }
     updateVisibleData();
+    scrollRows(previousTopLine);
 }
 
 
@@ -1040,16 +1931,22 @@ void HexEditor::addTag(quint64 offset, quint64 length, const QString &descriptio
     qDebug() << "Adding tags" << type;
 
     tags.append(Tag{offset, length, description, color.name(),"",type});
+    tagIndex.invalidate();
+    invalidateRows();
 
     emit tagsUpdated(tags);
 
-    viewport()->update();
+    if (length > 0) {
+        updateByteRange(offset, offset + length - 1);
+    }
 
 
 }
 
 void HexEditor::clearTags(){
     tags.clear();
+    tagIndex.invalidate();
+    invalidateRows();
 
     emit tagsUpdated(tags);
 
@@ -1098,10 +1995,14 @@ void HexEditor::removeTag(quint64 offset, int index, const QString &tagType)
     // Remove the selected tag(s)
     for (const Tag &tagToRemove : tagsToRemove) {
         tags.removeOne(tagToRemove);
+        if (tagToRemove.length > 0) {
+            updateByteRange(tagToRemove.offset, tagToRemove.offset + tagToRemove.length - 1);
+        }
     }
+    tagIndex.invalidate();
+    invalidateRows();
 
     emit tagsUpdated(tags);
-    viewport()->update();
 
     QMessageBox::information(this, tr("Tag Deleted"),
                              tr("%n %1 tag(s) deleted successfully.", "", tagsToRemove.size()).arg(tagType));
@@ -1220,8 +2121,7 @@ void HexEditor::exportTagDataByOffset(quint64 offset, const QString &fileName)
     // Read the data from the file at the specified offset and length
     QByteArray data;
     if (device->isOpen()) {
-        device->seek(tag.offset);
-        data = device->read(tag.length);
+        data = source->readBytes(tag.offset, tag.length);
     } else {
         qDebug() << "File is not open.";
         return;
@@ -1264,17 +2164,13 @@ void HexEditor::search(const QString &pattern, SearchType type)
 void HexEditor::searchInHex(const QByteArray &pattern)
 {
     searchResults.clear();
+    currentSearchIndex = -1;
+    invalidateRows();
 
     searchInHexFromPosition(pattern, 0);
 
     if (!searchResults.isEmpty()) {
-        setSelectedByte(searchResults.first().first);
-        quint64 searchStart = searchResults.first().first;
-
-        highligtedOffsets.clear();
-        for (int i = 0; i < pattern.size(); ++i) {
-            highligtedOffsets.insert(searchStart + i);
-        }
+        showSearchHit(0);
     }
 
     viewport()->update();
@@ -1282,39 +2178,29 @@ void HexEditor::searchInHex(const QByteArray &pattern)
 
 void HexEditor::searchInAscii(const QString &pattern)
 {
-
     searchResults.clear();
+    currentSearchIndex = -1;
+    invalidateRows();
 
     searchInAsciiFromPosition(pattern, 0);
 
     if (!searchResults.isEmpty()) {
-        setSelectedByte(searchResults.first().first);
-        quint64 searchStart = searchResults.first().first;
-
-        highligtedOffsets.clear();
-        for (int i = 0; i < pattern.size(); ++i) {
-            highligtedOffsets.insert(searchStart + i);
-        }
+        showSearchHit(0);
     }
 
     viewport()->update();
-
 }
 
 void HexEditor::searchInUtf16(const QString &pattern)
 {
     searchResults.clear();
+    currentSearchIndex = -1;
+    invalidateRows();
 
     searchInUtf16FromPosition(pattern, 0);
 
     if (!searchResults.isEmpty()) {
-        setSelectedByte(searchResults.first().first);
-        quint64 searchStart = searchResults.first().first;
-
-        highligtedOffsets.clear();
-        for (int i = 0; i < pattern.size(); ++i) {
-            highligtedOffsets.insert(searchStart + i);
-        }
+        showSearchHit(0);
     }
 
     viewport()->update();
@@ -1329,10 +2215,17 @@ void HexEditor::nextSearch()
         return;
     }
 
+    // After a find-all the following hits are already known
+    if (currentSearchIndex + 1 < searchResults.size()) {
+        showSearchHit(currentSearchIndex + 1);
+        viewport()->update();
+        return;
+    }
 
-
-    quint64 startPosition = searchResults.last().second + 1;
-    searchResults.clear();
+    // Hits found earlier stay in the list, so they stay highlighted. Like find all,
+    // the next hit may overlap the previous one.
+    quint64 startPosition = searchResults.last().first + 1;
+    const int knownHits = searchResults.size();
 
     switch (currentSearchType) {
     case SearchType::Hex:
@@ -1346,137 +2239,231 @@ void HexEditor::nextSearch()
         break;
     }
 
-    if (!searchResults.isEmpty()) {
-        currentSearchIndex = 0;
+    if (searchResults.size() > knownHits) {
+        invalidateRows();
+        showSearchHit(knownHits);
+    }
+    viewport()->update();
+}
 
-        highligtedOffsets.clear();
-        quint64 searchStart = searchResults.first().first;
+void HexEditor::searchAll(const QString &pattern, SearchType type)
+{
+    currentSearchPattern = pattern;
+    currentSearchType = type;
+    searchResults.clear();
+    currentSearchIndex = -1;
+    invalidateRows();
 
+    const QByteArray patternBytes = searchPatternBytes();
+    if (!searchMappedFromPosition(patternBytes, 0, MaxSearchHits)) {
+        searchSourceFromPosition(patternBytes, 0, MaxSearchHits);
+    }
 
-        if(currentSearchType==SearchType::Hex){
-           // qDebug() << "pattern Size : " << QByteArray::fromHex(currentSearchPattern.toUtf8()).size();
+    if (!searchResults.isEmpty()) {
+        showSearchHit(0);
+    }
+    viewport()->update();
 
-            for (int i = 0; i < QByteArray::fromHex(currentSearchPattern.toUtf8()).size(); ++i) {
-                highligtedOffsets.insert(searchStart + i);
-            }
-        }else if(currentSearchType==SearchType::Utf16){
+    if (searchResults.size() >= MaxSearchHits) {
+        qDebug() << "Find all stopped after" << MaxSearchHits << "hits";
+        QMessageBox::information(this, tr("Find All"),
+                                 tr("Only the first %1 hits are highlighted. Use Next to continue after the last one.").arg(MaxSearchHits));
+    }
+}
 
+QByteArray HexEditor::searchPatternBytes() const
+{
+    switch (currentSearchType) {
+    case SearchType::Hex:
+        return QByteArray::fromHex(currentSearchPattern.toUtf8());
+    case SearchType::Utf16: {
+        const char16_t *patternUtf16 = reinterpret_cast<const char16_t *>(currentSearchPattern.utf16());
+        return QByteArray(reinterpret_cast<const char *>(patternUtf16), currentSearchPattern.size() * 2);
+    }
+    default:
+        return currentSearchPattern.toUtf8();
+    }
+}
 
-            const char16_t *patternUtf16 = reinterpret_cast<const char16_t *>(currentSearchPattern.utf16());
-            QByteArray patternBytes(reinterpret_cast<const char *>(patternUtf16), currentSearchPattern.size() * 2);
+void HexEditor::showSearchHit(int index)
+{
+    currentSearchIndex = index;
+    setSelectedByte(searchResults.at(index).first);
+}
 
-           // qDebug() << "patternBytes Hex : " << patternBytes;
-            for (int i = 0; i < patternBytes.size(); ++i) {
-                highligtedOffsets.insert(searchStart + i);
-            }
+// Binary search for the first hit ending at or after from, the ends are sorted
+QList<QPair<quint64, quint64>> HexEditor::searchHitsIn(quint64 from, quint64 to) const
+{
+    QList<QPair<quint64, quint64>> hits;
+    auto it = std::lower_bound(searchResults.constBegin(), searchResults.constEnd(), from,
+                               [](const QPair<quint64, quint64> &hit, quint64 value) { return hit.second < value; });
+    for (; it != searchResults.constEnd() && it->first < to; ++it) {
+        hits.append(*it);
+    }
+    return hits;
+}
 
-        }
 
-        else{
+bool HexEditor::searchMappedFromPosition(const QByteArray &pattern, quint64 startPosition, int maxHits)
+{
+    MappedImageDevice *mappedDevice = qobject_cast<MappedImageDevice *>(device);
+    if (!mappedDevice || !mappedDevice->isFullyMapped() || pattern.isEmpty()) {
+        return false;
+    }
+
+    if (startPosition >= fileSize) {
+        return true;
+    }
 
-            QByteArray patternBytes = currentSearchPattern.toUtf8();
-           // qDebug() << "patternBytes : " << patternBytes;
-            for (int i = 0; i < patternBytes.size(); ++i) {
-                highligtedOffsets.insert(searchStart + i);
+    // A pattern with a non-zero byte can not match inside an empty region
+    const bool skipEmpty = pattern.count('\0') != pattern.size();
+    const qint64 overlap = pattern.size() - 1;
+    std::boyer_moore_horspool_searcher searcher(pattern.begin(), pattern.end());
+
+    // Scan the mapping directly, the kernel reads ahead while we search
+    mappedDevice->setAccessPattern(MappedImageDevice::SequentialAccess);
+    qint64 position = startPosition;
+    int hits = 0;
+    while (position < static_cast<qint64>(fileSize)) {
+        qint64 runStart = position;
+        qint64 runEnd = fileSize;
+        if (skipEmpty) {
+            const qint64 dataStart = sparseMap->nextNonEmpty(position);
+            if (dataStart >= static_cast<qint64>(fileSize)) {
+                break;
             }
+            runStart = qMax(position, dataStart - overlap);
+            runEnd = qMin<qint64>(fileSize, sparseMap->nextEmpty(dataStart) + overlap);
+        }
 
+        // The run is searched in slices, each taken right before it is touched so a
+        // file truncated during the search stops it instead of raising SIGBUS
+        bool truncated = false;
+        qint64 sliceStart = runStart;
+        while (hits < maxHits) {
+            const qint64 sliceEnd = qMin(runEnd, sliceStart + MappedSearchSlice + overlap);
+            const char *slice = reinterpret_cast<const char *>(mappedDevice->span(sliceStart, sliceEnd - sliceStart));
+            if (!slice) {
+                truncated = true;
+                break;
+            }
 
+            // Hits starting in the overlap are left to the next slice, which holds them whole
+            const char *end = slice + (sliceEnd - sliceStart);
+            const char *limit = sliceEnd >= static_cast<qint64>(fileSize) ? end : end - overlap;
+            const char *res = std::search(slice, end, searcher);
+            while (res < limit && hits < maxHits) {
+                quint64 matchPos = sliceStart + (res - slice);
+                searchResults.append(qMakePair(matchPos, matchPos + pattern.size() - 1));
+                ++hits;
+                res = std::search(res + 1, end, searcher);
+            }
+            if (sliceEnd >= runEnd) {
+                break;
+            }
+            sliceStart = sliceEnd - overlap;
         }
-
-        setSelectedByte(searchResults.first().first);
+        if (truncated) {
+            qDebug() << "Image is no longer backed past" << sliceStart << "bytes, search stopped";
+            break;
+        }
+        if (hits >= maxHits || runEnd >= static_cast<qint64>(fileSize)) {
+            break;
+        }
+        position = runEnd - overlap;
     }
-    viewport()->update();
+    mappedDevice->setAccessPattern(MappedImageDevice::RandomAccess);
+    return true;
 }
 
-
-void HexEditor::searchInHexFromPosition(const QByteArray &pattern, quint64 startPosition)
+// Streams the evidence source in large chunks, used for every image that is not
+// a single mapped file (E01, split raw sets, drives) so offsets are image offsets
+bool HexEditor::searchSourceFromPosition(const QByteArray &pattern, quint64 startPosition, int maxHits)
 {
-    const int chunkSize = 4096; // Read in chunks of 4 KB
-    std::ifstream is(file_name.toStdString(), std::ios::binary);
-    if (!is) return;
+    if (!source || pattern.isEmpty()) {
+        return false;
+    }
 
-    is.seekg(startPosition);
-    std::vector<char> buffer(chunkSize + pattern.size() - 1);
-    quint64 currentPos = startPosition;
+    // Double-buffered so the next chunk is read while this one is searched
+    EvidenceSource *directSource = scanSource();
+    BufferedEvidenceDevice reader(directSource, BufferedEvidenceDevice::Policy::streaming());
+    reader.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    const qint64 chunkSize = reader.policy().blockSize;
+    const qint64 overlap = pattern.size() - 1;
+    QByteArray buffer(chunkSize + overlap, Qt::Uninitialized);
+    std::boyer_moore_horspool_searcher searcher(pattern.begin(), pattern.end());
+    // A pattern with a non-zero byte can not match inside an empty region, so
+    // only the bytes of non-empty blocks are read
+    const bool skipEmpty = pattern.count('\0') != pattern.size();
+
+    qint64 currentPos = startPosition;
+    int hits = 0;
+    while (currentPos < static_cast<qint64>(fileSize)) {
+        qint64 span = chunkSize;
+        if (skipEmpty) {
+            const qint64 dataStart = sparseMap->nextNonEmpty(currentPos);
+            if (dataStart >= static_cast<qint64>(fileSize)) {
+                break;
+            }
+            currentPos = qMax(currentPos, dataStart - overlap);
+            span = qBound<qint64>(1, sparseMap->nextEmpty(dataStart) - currentPos, chunkSize);
+        }
 
-    while (is) {
-        is.read(buffer.data(), buffer.size());
-        std::streamsize bytesRead = is.gcount();
-        if (bytesRead < pattern.size()) break;
+        // A data island shorter than a chunk is read as is, the reader would fetch a
+        // whole block for it and then read ahead into the empty run that follows
+        const qint64 bytesRead = span < chunkSize
+            ? directSource->readAt(currentPos, buffer.data(), span + overlap)
+            : reader.readAt(currentPos, buffer.data(), span + overlap);
+        if (bytesRead < pattern.size()) {
+            break;
+        }
 
-        auto res = std::search(buffer.begin(), buffer.begin() + bytesRead, pattern.begin(), pattern.end());
-        if (res != buffer.begin() + bytesRead) {
-            quint64 matchPos = currentPos + std::distance(buffer.begin(), res);
+        // Hits starting past span are left to the next chunk, which reads them whole
+        const char *begin = buffer.constData();
+        const char *res = std::search(begin, begin + bytesRead, searcher);
+        while (res < begin + span && res != begin + bytesRead && hits < maxHits) {
+            quint64 matchPos = currentPos + (res - begin);
             searchResults.append(qMakePair(matchPos, matchPos + pattern.size() - 1));
+            ++hits;
+            res = std::search(res + 1, begin + bytesRead, searcher);
+        }
+        if (hits >= maxHits) {
             break;
         }
 
-        currentPos += chunkSize;
-        is.seekg(currentPos);
+        currentPos += span;
     }
+    return true;
 }
 
-
-void HexEditor::searchInAsciiFromPosition(const QString &pattern, quint64 startPosition)
+// Scans go straight to the backend so they do not flush the page cache
+EvidenceSource *HexEditor::scanSource() const
 {
-    qDebug() << "next searching " << pattern << "from pos" << startPosition;
-    QByteArray patternBytes = pattern.toUtf8();
-    const int chunkSize = 4096; // Read in chunks of 4 KB
-    std::ifstream is(file_name.toStdString(), std::ios::binary);
-    if (!is) return;
-
-    is.seekg(startPosition);
-    std::vector<char> buffer(chunkSize + patternBytes.size() - 1);
-    quint64 currentPos = startPosition;
-
-    while (is) {
-        is.read(buffer.data(), buffer.size());
-        std::streamsize bytesRead = is.gcount();
-        if (bytesRead < patternBytes.size()) break;
-
-        auto res = std::search(buffer.begin(), buffer.begin() + bytesRead, patternBytes.begin(), patternBytes.end());
-        if (res != buffer.begin() + bytesRead) {
-            quint64 matchPos = currentPos + std::distance(buffer.begin(), res);
-            searchResults.append(qMakePair(matchPos, matchPos + patternBytes.size() - 1));
-            qDebug() << "searchResults " << searchResults;
-            return;
-        }
-
-        currentPos += chunkSize;
-        is.seekg(currentPos);
+    CachedDevice *cachedDevice = qobject_cast<CachedDevice *>(device);
+    if (cachedDevice && dynamic_cast<EvidenceSource *>(cachedDevice->backend())) {
+        return dynamic_cast<EvidenceSource *>(cachedDevice->backend());
     }
+    return source;
+}
 
-    qDebug() << "searchResults " << searchResults;
+void HexEditor::searchInHexFromPosition(const QByteArray &pattern, quint64 startPosition)
+{
+    if (!searchMappedFromPosition(pattern, startPosition)) {
+        searchSourceFromPosition(pattern, startPosition);
+    }
+}
 
+void HexEditor::searchInAsciiFromPosition(const QString &pattern, quint64 startPosition)
+{
+    qDebug() << "next searching " << pattern << "from pos" << startPosition;
+    searchInHexFromPosition(pattern.toUtf8(), startPosition);
 }
 
 void HexEditor::searchInUtf16FromPosition(const QString &pattern, quint64 startPosition)
 {
     const char16_t *patternUtf16 = reinterpret_cast<const char16_t *>(pattern.utf16());
-    QByteArray patternBytes(reinterpret_cast<const char *>(patternUtf16), pattern.size() * 2);
-    const int chunkSize = 4096; // Read in chunks of 4 KB
-    std::ifstream is(file_name.toStdString(), std::ios::binary);
-    if (!is) return;
-
-    is.seekg(startPosition);
-    std::vector<char> buffer(chunkSize + patternBytes.size() - 1);
-    quint64 currentPos = startPosition;
-
-    while (is) {
-        is.read(buffer.data(), buffer.size());
-        std::streamsize bytesRead = is.gcount();
-        if (bytesRead < patternBytes.size()) break;
-
-        auto res = std::search(buffer.begin(), buffer.begin() + bytesRead, patternBytes.begin(), patternBytes.end());
-        if (res != buffer.begin() + bytesRead) {
-            quint64 matchPos = currentPos + std::distance(buffer.begin(), res);
-            searchResults.append(qMakePair(matchPos, matchPos + patternBytes.size() - 1));
-            break;
-        }
-
-        currentPos += chunkSize;
-        is.seekg(currentPos);
-    }
+    searchInHexFromPosition(QByteArray(reinterpret_cast<const char *>(patternUtf16), pattern.size() * 2), startPosition);
 }
 
 
@@ -1485,8 +2472,9 @@ void  HexEditor::clearSearchResults(){
 
    // qDebug() << "clear searchResults " ;
 
-    highligtedOffsets.clear();
     searchResults.clear();
+    currentSearchIndex = -1;
+    invalidateRows();
     viewport()->update();
 
 }
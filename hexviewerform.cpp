@@ -46,6 +46,14 @@ HexViewerForm::HexViewerForm(QWidget *parent)
 
 
     connect(ui->markersTableView, &QTableView::doubleClicked, this, &HexViewerForm::onMarkersTableDoubleClicked);
+    // Warm the target as soon as a row is picked, so the double-click jump lands on cached data
+    connect(ui->markersTableView, &QTableView::clicked, this, [this](const QModelIndex &index) {
+        bool ok;
+        quint64 offset = ui->markersTableView->model()->data(ui->markersTableView->model()->index(index.row(), 0), Qt::DisplayRole).toString().toULongLong(&ok);
+        if (ok) {
+            ui->hexEditorWidget->prefetchAround(offset);
+        }
+    });
 
 
     ui->tagstabWidget->setVisible(false);
@@ -72,6 +80,9 @@ HexViewerForm::HexViewerForm(QWidget *parent)
     ui->TemplateTagstableView->setModel(templateTagsTableModel);
     ui->TemplateTagstableView->setSelectionBehavior(QAbstractItemView::SelectRows); // Ensure rows are selected
     connect(ui->TemplateTagstableView, &QTableView::doubleClicked, this, &HexViewerForm::onTemplateTagTableDoubleClicked);
+    connect(ui->TemplateTagstableView, &QTableView::clicked, this, [this](const QModelIndex &index) {
+        ui->hexEditorWidget->prefetchAround(templateTagsTableModel->data(templateTagsTableModel->index(index.row(), 0)).toULongLong());
+    });
 
 
     tagsTableModel->setFilterType("user");
@@ -80,6 +91,9 @@ HexViewerForm::HexViewerForm(QWidget *parent)
 
     ui->tagsTableView->setSelectionBehavior(QAbstractItemView::SelectRows); // Ensure rows are selected
     connect(ui->tagsTableView, &QTableView::doubleClicked, this, &HexViewerForm::onTagTableDoubleClicked);
+    connect(ui->tagsTableView, &QTableView::clicked, this, [this](const QModelIndex &index) {
+        ui->hexEditorWidget->prefetchAround(tagsTableModel->data(tagsTableModel->index(index.row(), 0)).toULongLong());
+    });
 
 
     connect(ui->hexEditorWidget, &HexEditor::tagsUpdated, this, &HexViewerForm::updateTagsTable);
@@ -98,6 +112,7 @@ HexViewerForm::HexViewerForm(QWidget *parent)
     connect(ui->searchNextButton, &QPushButton::clicked, this, &HexViewerForm::onSearchNextButtonClicked);
 
     connect(searchForm->getSearchButton(), &QPushButton::clicked, this, &HexViewerForm::onSearchButtonClicked);
+    connect(searchForm->getFindAllButton(), &QPushButton::clicked, this, &HexViewerForm::onFindAllButtonClicked);
 
     connect(ui->searchButton, &QPushButton::clicked, this, &HexViewerForm::onOpenSearchForm);
 
@@ -124,22 +139,25 @@ void HexViewerForm::onOpenSearchForm()
     searchForm->show();
 }
 
-void HexViewerForm::onSearchButtonClicked()
+HexEditor::SearchType HexViewerForm::selectedSearchType() const
 {
-    QString searchPattern = searchForm->getSearchPattern();
     QString searchTypeStr = searchForm->getSearchType();
 
-    HexEditor::SearchType searchType;
     if (searchTypeStr == "HEX") {
-        searchType = HexEditor::SearchType::Hex;
+        return HexEditor::SearchType::Hex;
     } else if (searchTypeStr == "ASCII") {
-        searchType = HexEditor::SearchType::Ascii;
+        return HexEditor::SearchType::Ascii;
     } else if (searchTypeStr == "UTF-16") {
-        searchType = HexEditor::SearchType::Utf16;
-    } else {
-        // Default to Ascii if type is unrecognized
-        searchType = HexEditor::SearchType::Ascii;
+        return HexEditor::SearchType::Utf16;
     }
+    // Default to Ascii if type is unrecognized
+    return HexEditor::SearchType::Ascii;
+}
+
+void HexViewerForm::onSearchButtonClicked()
+{
+    QString searchPattern = searchForm->getSearchPattern();
+    HexEditor::SearchType searchType = selectedSearchType();
 
     loadingDialog->setMessage("Loading , please wait...");
     loadingDialog->show();
@@ -151,6 +169,21 @@ void HexViewerForm::onSearchButtonClicked()
     loadingDialog->hide();
 }
 
+void HexViewerForm::onFindAllButtonClicked()
+{
+    QString searchPattern = searchForm->getSearchPattern();
+    HexEditor::SearchType searchType = selectedSearchType();
+
+    loadingDialog->setMessage("Loading , please wait...");
+    loadingDialog->show();
+    qApp->processEvents();
+
+    ui->hexEditorWidget->searchAll(searchPattern, searchType);
+
+    searchForm->hide();
+    loadingDialog->hide();
+}
+
 void HexViewerForm::onSearchNextButtonClicked()
 {
     loadingDialog->setMessage("Loading , please wait...");
@@ -309,6 +342,8 @@ void HexViewerForm::openFile(const QString &fileName,int tabIndex)
     hexEditor->setTagsHandler(tagsHandler);
     hexEditor->setUserTagsHandler(userTagsHandler);
 
+    // The file system handler may still read through the device being replaced
+    fsHandler->closeImage();
     hexEditor->setData(m_fileName, tabIndex);
 
     hexEditor->setSelectedByte(0);
@@ -385,7 +420,12 @@ void HexViewerForm::on_readAsImageButton_clicked()
 
 
 
-        fsHandler->openImage(m_fileName);
+        // TSK reads through the same device and page cache as the hex view
+        if (ui->hexEditorWidget->evidenceSource()) {
+            fsHandler->openEvidence(ui->hexEditorWidget->evidenceSource());
+        } else {
+            fsHandler->openImage(m_fileName);
+        }
         ui->FileSystemTabWidget->clear();
         currentDirMap.clear();
         tabPartitionMap.clear();
@@ -548,6 +588,15 @@ void HexViewerForm::populateMarkersTable()
 {
     QList<QStringList> partitionDetails = fsHandler->getPartitionDetails();
     markersTableModel->setMarkerData(partitionDetails);
+
+    // Partition starts are the usual jump targets, warm them up front
+    for (int row = 0; row < markersTableModel->rowCount(); ++row) {
+        bool ok;
+        quint64 offset = markersTableModel->data(markersTableModel->index(row, 0), Qt::DisplayRole).toString().toULongLong(&ok);
+        if (ok) {
+            ui->hexEditorWidget->prefetchAround(offset);
+        }
+    }
 }
 
 
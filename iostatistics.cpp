@@ -0,0 +1,105 @@
+#include "headers/iostatistics.h"
+#include <QtAlgorithms>
+
+IoStatistics::IoStatistics()
+    : m_reads(0),
+    m_bytesRead(0),
+    m_errors(0),
+    m_cacheHits(0),
+    m_cacheMisses(0),
+    m_outstanding(0)
+{
+    for (QAtomicInteger<quint64> &bucket : m_latency) {
+        bucket.storeRelaxed(0);
+    }
+}
+
+void IoStatistics::recordRead(qint64 bytesRead, qint64 nanoseconds)
+{
+    m_reads.fetchAndAddRelaxed(1);
+    if (bytesRead < 0) {
+        m_errors.fetchAndAddRelaxed(1);
+    } else {
+        m_bytesRead.fetchAndAddRelaxed(static_cast<quint64>(bytesRead));
+    }
+
+    const quint64 microseconds = static_cast<quint64>(qMax<qint64>(nanoseconds, 0)) / 1000;
+    const int bucket = microseconds == 0 ? 0 : 64 - qCountLeadingZeroBits(microseconds);
+    m_latency[qMin(bucket, LatencyBuckets - 1)].fetchAndAddRelaxed(1);
+}
+
+void IoStatistics::recordCacheHit(quint64 count)
+{
+    m_cacheHits.fetchAndAddRelaxed(count);
+}
+
+void IoStatistics::recordCacheMiss(quint64 count)
+{
+    m_cacheMisses.fetchAndAddRelaxed(count);
+}
+
+void IoStatistics::beginAsync()
+{
+    m_outstanding.fetchAndAddRelaxed(1);
+}
+
+void IoStatistics::endAsync()
+{
+    m_outstanding.fetchAndSubRelaxed(1);
+}
+
+// Counters are read one by one, a snapshot taken during reads may be off by
+// the reads in flight, which is fine for a once per second display
+IoStatistics::Snapshot IoStatistics::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.reads = m_reads.loadRelaxed();
+    snapshot.bytesRead = m_bytesRead.loadRelaxed();
+    snapshot.errors = m_errors.loadRelaxed();
+    snapshot.cacheHits = m_cacheHits.loadRelaxed();
+    snapshot.cacheMisses = m_cacheMisses.loadRelaxed();
+    snapshot.outstanding = m_outstanding.loadRelaxed();
+    for (int bucket = 0; bucket < LatencyBuckets; ++bucket) {
+        snapshot.latency[bucket] = m_latency[bucket].loadRelaxed();
+    }
+    return snapshot;
+}
+
+double IoStatistics::Snapshot::hitRatio() const
+{
+    const quint64 lookups = cacheHits + cacheMisses;
+    return lookups > 0 ? static_cast<double>(cacheHits) / lookups : -1.0;
+}
+
+quint64 IoStatistics::Snapshot::latencyPercentile(double percentile) const
+{
+    quint64 total = 0;
+    for (quint64 count : latency) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    const quint64 rank = qMax<quint64>(1, static_cast<quint64>(total * qBound(0.0, percentile, 100.0) / 100.0 + 0.5));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < LatencyBuckets; ++bucket) {
+        seen += latency[bucket];
+        if (seen >= rank) {
+            return quint64(1) << bucket;
+        }
+    }
+    return quint64(1) << (LatencyBuckets - 1);
+}
+
+IoStatistics::ReadTimer::ReadTimer(IoStatistics &statistics)
+    : m_statistics(statistics)
+{
+    m_timer.start();
+}
+
+qint64 IoStatistics::ReadTimer::finish(qint64 bytesRead)
+{
+    m_statistics.recordRead(bytesRead, m_timer.nsecsElapsed());
+    return bytesRead;
+}
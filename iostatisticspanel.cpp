@@ -0,0 +1,128 @@
+#include "headers/iostatisticspanel.h"
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+namespace {
+enum Column {
+    LayerColumn,
+    ReadsColumn,
+    ThroughputColumn,
+    HitRatioColumn,
+    P50Column,
+    P99Column,
+    ErrorsColumn,
+    OutstandingColumn,
+    ColumnCount
+};
+}
+
+IoStatisticsPanel::IoStatisticsPanel(QWidget *parent)
+    : QWidget(parent),
+    m_table(new QTableWidget(0, ColumnCount, this))
+{
+    m_table->setHorizontalHeaderLabels({tr("Layer"), tr("Reads"), tr("MB/s"), tr("Cache hits"),
+                                        tr("p50"), tr("p99"), tr("Errors"), tr("Outstanding")});
+    m_table->verticalHeader()->hide();
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionMode(QAbstractItemView::NoSelection);
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_table->horizontalHeader()->setStretchLastSection(true);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_table);
+
+    m_refreshTimer.setInterval(RefreshIntervalMs);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &IoStatisticsPanel::refresh);
+}
+
+void IoStatisticsPanel::setHexEditor(HexEditor *editor)
+{
+    m_editor = editor;
+    m_previous.clear();
+    refresh();
+}
+
+// Counters are only polled while the panel can be seen
+void IoStatisticsPanel::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    m_refreshTimer.start();
+}
+
+void IoStatisticsPanel::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    m_refreshTimer.stop();
+}
+
+void IoStatisticsPanel::refresh()
+{
+    if (!m_editor) {
+        m_table->setRowCount(0);
+        return;
+    }
+
+    const double elapsedSeconds = m_sinceRefresh.isValid() ? m_sinceRefresh.restart() / 1000.0 : 0.0;
+    if (!m_sinceRefresh.isValid()) {
+        m_sinceRefresh.start();
+    }
+
+    const QList<HexEditor::IoLayer> layers = m_editor->ioLayers();
+    QHash<QString, IoStatistics::Snapshot> current;
+    m_table->setRowCount(layers.size());
+
+    for (int row = 0; row < layers.size(); ++row) {
+        const HexEditor::IoLayer &layer = layers.at(row);
+        const IoStatistics::Snapshot snapshot = layer.statistics->snapshot();
+        current.insert(layer.name, snapshot);
+
+        // A layer seen for the first time (or reopened evidence) has no rate yet
+        QString throughput = QStringLiteral("-");
+        const auto previous = m_previous.constFind(layer.name);
+        if (previous != m_previous.constEnd() && elapsedSeconds > 0 && snapshot.bytesRead >= previous->bytesRead) {
+            const double megabytes = (snapshot.bytesRead - previous->bytesRead) / (1024.0 * 1024.0);
+            throughput = QString::number(megabytes / elapsedSeconds, 'f', 1);
+        }
+
+        const double hitRatio = snapshot.hitRatio();
+        const QStringList cells = {
+            layer.name,
+            QString::number(snapshot.reads),
+            throughput,
+            hitRatio < 0 ? QStringLiteral("-") : QString::number(hitRatio * 100.0, 'f', 1) + "%",
+            snapshot.reads > 0 ? formatLatency(snapshot.latencyPercentile(50)) : QStringLiteral("-"),
+            snapshot.reads > 0 ? formatLatency(snapshot.latencyPercentile(99)) : QStringLiteral("-"),
+            QString::number(snapshot.errors),
+            QString::number(snapshot.outstanding)
+        };
+
+        for (int column = 0; column < ColumnCount; ++column) {
+            QTableWidgetItem *item = m_table->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                if (column != LayerColumn) {
+                    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                }
+                m_table->setItem(row, column, item);
+            }
+            item->setText(cells.at(column));
+        }
+    }
+
+    m_previous = current;
+}
+
+// Percentiles are bucket bounds, so they are shown as "below" values
+QString IoStatisticsPanel::formatLatency(quint64 microseconds)
+{
+    if (microseconds < 1000) {
+        return QString("< %1 us").arg(microseconds);
+    }
+    if (microseconds < 1000 * 1000) {
+        return QString("< %1 ms").arg(microseconds / 1000.0, 0, 'f', 1);
+    }
+    return QString("< %1 s").arg(microseconds / 1000000.0, 0, 'f', 1);
+}
@@ -5,6 +5,10 @@
 #include <QCloseEvent>
 #include <QRegularExpression>
 #include <QProgressDialog>
+#include <QDockWidget>
+#include <QToolButton>
+#include <QSettings>
+#include "headers/persistentchunkcache.h"
 
 
 //Multiple instances will be created for each tab Form
@@ -12,6 +16,11 @@
 //Open Dialog
 #include <QFileDialog>
 
+namespace {
+const char *const ChunkCacheSizeKey = "cache/chunkCacheSizeMb";
+// Upper limit offered in the settings dialog
+const int MaxChunkCacheSizeMb = 64 * 1024;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -19,8 +28,27 @@ MainWindow::MainWindow(QWidget *parent)
     ,dataTypeViewModel(new DataTypeViewModel(this))
     ,tagsHandler(nullptr)
     ,userTagsHandler(nullptr)
+    ,ioStatisticsPanel(new IoStatisticsPanel(this))
 {
     ui->setupUi(this);
+
+    // I/O statistics of the current tab, toggled from the status bar
+    QDockWidget *ioStatisticsDock = new QDockWidget(tr("I/O statistics"), this);
+    ioStatisticsDock->setObjectName("ioStatisticsDock");
+    ioStatisticsDock->setWidget(ioStatisticsPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, ioStatisticsDock);
+    ioStatisticsDock->hide();
+    QToolButton *ioStatisticsButton = new QToolButton(this);
+    ioStatisticsButton->setDefaultAction(ioStatisticsDock->toggleViewAction());
+    ui->statusbar->addPermanentWidget(ioStatisticsButton);
+
+    // The on-disk chunk cache is off until the user gives it space
+    QAction *chunkCacheAction = new QAction(tr("Disk cache..."), this);
+    connect(chunkCacheAction, &QAction::triggered, this, &MainWindow::configureChunkCache);
+    QToolButton *chunkCacheButton = new QToolButton(this);
+    chunkCacheButton->setDefaultAction(chunkCacheAction);
+    ui->statusbar->addPermanentWidget(chunkCacheButton);
+
     connect(ui->actionOpen, &QAction::triggered, this, &MainWindow::openFile);
     connect(ui->openButton, &QPushButton::clicked, this, &MainWindow::openFile);
 
@@ -69,6 +97,32 @@ void MainWindow::setUserTagsHandler(TagsHandler *userTagsHandler)
     this->userTagsHandler = userTagsHandler;
 }
 
+qint64 MainWindow::chunkCacheSize() const
+{
+    QSettings settings("SUMURI", "SumuriHexViewer");
+    return settings.value(ChunkCacheSizeKey, 0).toLongLong() * 1024 * 1024;
+}
+
+void MainWindow::configureChunkCache()
+{
+    bool ok = false;
+    const int sizeMb = QInputDialog::getInt(this, tr("Disk cache"),
+                                            tr("Disk space for decompressed E01 chunks in MB, shared by all images (0 turns the cache off).\n"
+                                               "Applies to images opened afterwards."),
+                                            static_cast<int>(chunkCacheSize() / (1024 * 1024)), 0, MaxChunkCacheSizeMb, 256, &ok);
+    if (!ok) {
+        return;
+    }
+
+    QSettings settings("SUMURI", "SumuriHexViewer");
+    settings.setValue(ChunkCacheSizeKey, sizeMb);
+    if (sizeMb == 0) {
+        // Free the space now, a tab still writing to its cache is not disturbed and
+        // the index it saves on close no longer matches, so it is discarded later
+        PersistentChunkCache::trimDirectory(PersistentChunkCache::defaultDirectory(), 0, QString());
+    }
+}
+
 MainWindow::~MainWindow()
 {
     delete ui;
@@ -117,6 +171,7 @@ void MainWindow::createNewTab(const QString &fileName, bool sync)
 
     hexViewerForm->setTagsHandler(tagsHandler);
     hexViewerForm->setUserTagsHandler(userTagsHandler);
+    hexViewerForm->hexEditor()->setPersistentChunkCacheSize(chunkCacheSize());
 
 
     hexViewerForm->openFile(fileName,index);
@@ -124,7 +179,8 @@ void MainWindow::createNewTab(const QString &fileName, bool sync)
     ui->tabWidget->setCurrentIndex(index);
     ui->tabWidget->setFocus();
 
-    connect(hexViewerForm->hexEditor(), &HexEditor::selectionChanged, dataTypeViewModel, &DataTypeViewModel::updateData);
+    connect(hexViewerForm->hexEditor(), &HexEditor::selectionChanged, this, &MainWindow::onSelectionChanged, Qt::UniqueConnection);
+    connect(hexViewerForm->hexEditor(), &HexEditor::selectedBytesReady, this, &MainWindow::onSelectedBytesReady, Qt::UniqueConnection);
     connect(hexViewerForm->hexEditor(), &HexEditor::tagNameAndLength, this, &MainWindow::onTagNameAndLength);
 
 }
@@ -132,28 +188,45 @@ void MainWindow::createNewTab(const QString &fileName, bool sync)
 void MainWindow::onTabChanged(int index)
 {
     HexViewerForm *currentHexViewer = qobject_cast<HexViewerForm*>(ui->tabWidget->widget(index));
+    ioStatisticsPanel->setHexEditor(currentHexViewer ? currentHexViewer->hexEditor() : nullptr);
     if (currentHexViewer) {
         HexEditor *hexEditor = currentHexViewer->hexEditor();
         if (hexEditor) {
-            connect(hexEditor, &HexEditor::selectionChanged, dataTypeViewModel, &DataTypeViewModel::updateData);
-            connect(hexEditor, &HexEditor::selectionChanged, this, &MainWindow::onSelectionChanged);
+            connect(hexEditor, &HexEditor::selectionChanged, this, &MainWindow::onSelectionChanged, Qt::UniqueConnection);
+            connect(hexEditor, &HexEditor::selectedBytesReady, this, &MainWindow::onSelectedBytesReady, Qt::UniqueConnection);
             connect(hexEditor, &HexEditor::tagNameAndLength, this, &MainWindow::onTagNameAndLength);
 
-            dataTypeViewModel->updateData(hexEditor->getSelectedBytes());
+            hexEditor->requestSelectedBytes(DataTypeViewModel::MaxInterpretedBytes);
         }
     }
 }
 
+void MainWindow::onSelectedBytesReady(const QByteArray &bytes)
+{
+    // A read that finishes after switching tabs belongs to the tab left behind
+    HexViewerForm *currentHexViewer = qobject_cast<HexViewerForm*>(ui->tabWidget->currentWidget());
+    if (currentHexViewer && currentHexViewer->hexEditor() == sender()) {
+        dataTypeViewModel->updateData(bytes);
+    }
+}
+
 void MainWindow::onEndianCheckboxStateChanged(quint64 state)
 {
     bool isBigEndian = (state == Qt::Checked);
     dataTypeViewModel->setEndian(isBigEndian);
 }
 
-void MainWindow::onSelectionChanged(const QByteArray &selectedData, quint64 startOffset, quint64 endOffset)
+void MainWindow::onSelectionChanged(quint64 startOffset, quint64 endOffset, quint64 selectedLength)
 {
+    // Only the few bytes the data types need are read, whatever the selection size,
+    // and never on the GUI thread. They arrive through onSelectedBytesReady.
+    HexEditor *hexEditor = qobject_cast<HexEditor *>(sender());
+    if (hexEditor) {
+        hexEditor->requestSelectedBytes(DataTypeViewModel::MaxInterpretedBytes);
+    }
+
     // Update the selection details
-    int selectionCount = selectedData.size();
+    quint64 selectionCount = selectedLength;
     QString selectionDetails = QString("Selection : %1 - %2")
                                    .arg(startOffset)
                                    .arg(endOffset);
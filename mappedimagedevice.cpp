@@ -0,0 +1,326 @@
+#include "headers/mappedimagedevice.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStorageInfo>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+// Window size used when the whole image can not be mapped (32-bit address space)
+const qint64 SlidingWindowLength = 256 * 1024 * 1024;
+// Windows allocation granularity, also a multiple of the page size everywhere else
+const qint64 WindowAlignment = 64 * 1024;
+}
+
+MappedImageDevice::MappedImageDevice(const QString &fileName, QObject *parent)
+    : QIODevice(parent),
+    m_file(fileName),
+    m_fileSize(0),
+    m_windowLength(0),
+    m_window(nullptr),
+    m_windowStart(0),
+    m_windowSize(0),
+    m_accessPattern(RandomAccess)
+{
+}
+
+bool MappedImageDevice::canMapSafely(const QString &fileName)
+{
+    QFileInfo fileInfo(fileName);
+    if (!fileInfo.exists() || !fileInfo.isFile()) {
+        return false;
+    }
+
+    QStorageInfo storage(fileInfo.absoluteFilePath());
+    if (!storage.isValid() || !storage.isReady()) {
+        return false;
+    }
+
+    // Network and FUSE mounts can drop out from under the mapping
+    const QByteArray fileSystem = storage.fileSystemType().toLower();
+    static const char *const remoteFileSystems[] = {
+        "nfs", "nfs4", "cifs", "smb", "smbfs", "smb3", "9p", "afs", "ceph", "glusterfs", "davfs", "sshfs"
+    };
+    for (const char *remote : remoteFileSystems) {
+        if (fileSystem == remote) {
+            return false;
+        }
+    }
+    if (fileSystem.startsWith("fuse")) {
+        return false;
+    }
+
+#if defined(Q_OS_LINUX)
+    // sysfs flags removable disks, a partition inherits the flag of its parent disk
+    const QString deviceName = QFileInfo(QString::fromLocal8Bit(storage.device())).fileName();
+    if (deviceName.isEmpty()) {
+        return false;
+    }
+    const QString sysfsPath = QFileInfo(QStringLiteral("/sys/class/block/") + deviceName).canonicalFilePath();
+    if (sysfsPath.isEmpty()) {
+        return false; // Not backed by a block device we can inspect (overlay, tmpfs, ...)
+    }
+    if (sysfsPath.contains(QStringLiteral("/usb")) || sysfsPath.contains(QStringLiteral("/mmc"))) {
+        return false;
+    }
+    for (const QString &candidate : {sysfsPath, QFileInfo(sysfsPath).path()}) {
+        QFile removable(candidate + QStringLiteral("/removable"));
+        if (removable.open(QIODevice::ReadOnly) && removable.readAll().trimmed() == "1") {
+            return false;
+        }
+    }
+    return true;
+#elif defined(Q_OS_WIN)
+    const QString root = QDir::toNativeSeparators(storage.rootPath());
+    return GetDriveTypeW(reinterpret_cast<LPCWSTR>(root.utf16())) == DRIVE_FIXED;
+#else
+    return !storage.rootPath().startsWith(QStringLiteral("/Volumes/"));
+#endif
+}
+
+MappedImageDevice::~MappedImageDevice()
+{
+    if (m_window) {
+        m_file.unmap(m_window);
+        m_window = nullptr;
+    }
+    m_file.close();
+    QIODevice::close();
+}
+
+bool MappedImageDevice::openMapped(OpenMode mode)
+{
+    if (!canMapSafely(m_file.fileName())) {
+        qDebug() << "Not mapping image on removable, remote or special storage:" << m_file.fileName();
+        return false;
+    }
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open image for mapping:" << m_file.errorString();
+        return false;
+    }
+
+    m_fileSize = m_file.size();
+    if (m_fileSize <= 0) {
+        m_file.close();
+        return false;
+    }
+
+    // Map everything at once when the address space allows it
+    m_windowLength = (sizeof(void *) >= 8) ? m_fileSize : qMin(m_fileSize, SlidingWindowLength);
+
+    if (!mapWindow(0, m_windowLength)) {
+        m_file.close();
+        return false;
+    }
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+qint64 MappedImageDevice::size() const
+{
+    return m_fileSize;
+}
+
+qint64 MappedImageDevice::mediaSize() const
+{
+    return m_fileSize;
+}
+
+bool MappedImageDevice::isFullyMapped() const
+{
+    return m_window && m_windowStart == 0 && m_windowSize == m_fileSize;
+}
+
+// Caller must hold m_mutex (except while opening)
+bool MappedImageDevice::mapWindow(qint64 offset, qint64 length)
+{
+    qint64 alignedStart = (offset / WindowAlignment) * WindowAlignment;
+    qint64 windowSize = qMin(qMax(m_windowLength, offset + length - alignedStart), m_fileSize - alignedStart);
+
+    if (m_window && alignedStart == m_windowStart && windowSize == m_windowSize) {
+        return true;
+    }
+
+    if (m_window) {
+        m_file.unmap(m_window);
+        m_window = nullptr;
+        m_windowSize = 0;
+    }
+
+    m_window = m_file.map(alignedStart, windowSize);
+    if (!m_window) {
+        qDebug() << "Failed to map image window at" << alignedStart << ":" << m_file.errorString();
+        return false;
+    }
+
+    m_windowStart = alignedStart;
+    m_windowSize = windowSize;
+    adviseWindow();
+    return true;
+}
+
+// Touching a mapped page past the end of a file that shrank raises SIGBUS, so the
+// size is checked again before the mapping is used.
+bool MappedImageDevice::isBacked(qint64 offset, qint64 length)
+{
+    return offset + length <= backedSize();
+}
+
+qint64 MappedImageDevice::backedSize() const
+{
+#ifdef Q_OS_UNIX
+    struct stat status;
+    if (fstat(m_file.handle(), &status) != 0) {
+        return 0;
+    }
+    if (status.st_size < m_fileSize) {
+        qDebug() << "Mapped image shrank from" << m_fileSize << "to" << status.st_size << "bytes";
+        return status.st_size;
+    }
+#endif
+    return m_fileSize;
+}
+
+void MappedImageDevice::adviseWindow()
+{
+#ifdef Q_OS_UNIX
+    int advice = (m_accessPattern == SequentialAccess) ? MADV_SEQUENTIAL : MADV_RANDOM;
+    if (madvise(m_window, static_cast<size_t>(m_windowSize), advice) != 0) {
+        qDebug() << "madvise failed for mapped image window";
+    }
+#endif
+}
+
+void MappedImageDevice::setAccessPattern(AccessPattern pattern)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_accessPattern == pattern) {
+        return;
+    }
+    m_accessPattern = pattern;
+    if (m_window) {
+        adviseWindow();
+    }
+}
+
+const uchar *MappedImageDevice::span(qint64 offset, qint64 length)
+{
+    if (offset < 0 || length < 0 || offset + length > m_fileSize) {
+        return nullptr;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    if (!isBacked(offset, length)) {
+        return nullptr;
+    }
+
+    if (!m_window || offset < m_windowStart || offset + length > m_windowStart + m_windowSize) {
+        if (!mapWindow(offset, length)) {
+            return nullptr;
+        }
+    }
+
+    return m_window + (offset - m_windowStart);
+}
+
+qint64 MappedImageDevice::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= m_fileSize) {
+        return 0;
+    }
+
+    IoStatistics::ReadTimer timer(m_statistics);
+    qint64 bytesRead = 0;
+
+    // The window must not move while copying, so the lock is held for the whole read
+    QMutexLocker locker(&m_mutex);
+
+    // A truncated image gives a short read like pread would
+    const qint64 fileSize = backedSize();
+    if (offset >= fileSize) {
+        return timer.finish(0);
+    }
+    qint64 bytesToRead = qMin(maxlen, fileSize - offset);
+
+    // Copy window by window so that sliding mode never maps more than one window
+    while (bytesRead < bytesToRead) {
+        qint64 position = offset + bytesRead;
+        qint64 chunk = qMin(bytesToRead - bytesRead, qMax(m_windowLength, WindowAlignment));
+        if (!m_window || position < m_windowStart || position + chunk > m_windowStart + m_windowSize) {
+            if (!mapWindow(position, chunk)) {
+                break;
+            }
+        }
+        memcpy(data + bytesRead, m_window + (position - m_windowStart), chunk);
+        bytesRead += chunk;
+    }
+
+    return timer.finish(bytesRead > 0 ? bytesRead : -1);
+}
+
+qint64 MappedImageDevice::tryReadAt(qint64 offset, char *data, qint64 maxlen)
+{
+    // A sliding window may have to be remapped, leave that to the I/O thread
+    if (!isFullyMapped()) {
+        return -1;
+    }
+    return readAt(offset, data, maxlen);
+}
+
+void MappedImageDevice::prefetch(qint64 offset, qint64 length)
+{
+    if (!isFullyMapped()) {
+        EvidenceSource::prefetch(offset, length);
+        return;
+    }
+
+    const qint64 end = qMin(offset + length, m_fileSize);
+    if (offset < 0 || offset >= end) {
+        return;
+    }
+
+#ifdef Q_OS_UNIX
+    // Let the kernel start the reads, madvise needs a page aligned address
+    const qint64 pageSize = sysconf(_SC_PAGESIZE);
+    const qint64 alignedStart = (offset / pageSize) * pageSize;
+    if (madvise(m_window + alignedStart, static_cast<size_t>(end - alignedStart), MADV_WILLNEED) != 0) {
+        qDebug() << "madvise(MADV_WILLNEED) failed for mapped image at" << alignedStart;
+    }
+#else
+    // Touch one byte per page to fault the range in
+    volatile uchar sink = 0;
+    for (qint64 position = offset; position < end; position += 4096) {
+        sink ^= m_window[position];
+    }
+    Q_UNUSED(sink);
+#endif
+}
+
+qint64 MappedImageDevice::readData(char *data, qint64 maxlen)
+{
+    return readAt(QIODevice::pos(), data, maxlen);
+}
+
+qint64 MappedImageDevice::writeData(const char *data, qint64 len)
+{
+    // Writing is not supported for this device.
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
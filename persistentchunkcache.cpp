@@ -0,0 +1,322 @@
+#include "headers/persistentchunkcache.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <climits>
+#include <cstring>
+
+namespace {
+const quint32 IndexMagic = 0x45434331; // "ECC1"
+const quint32 IndexVersion = 1;
+// The index is rewritten after this many new chunks, and when the cache closes
+const int WritesPerIndexSave = 1024;
+}
+
+PersistentChunkCache::PersistentChunkCache(const QString &directory, const QString &key, qint64 chunkSize, qint64 maxSize)
+    : m_dataPath(directory + "/" + key + ".chunks"),
+    m_indexPath(directory + "/" + key + ".index"),
+    m_chunkSize(chunkSize),
+    m_slotCount(static_cast<int>(qBound<qint64>(1, maxSize / qMax<qint64>(chunkSize, 1), INT_MAX))),
+    m_dataFile(m_dataPath),
+    m_nextUnused(0),
+    m_head(-1),
+    m_tail(-1),
+    m_writesSinceSave(0)
+{
+}
+
+PersistentChunkCache::~PersistentChunkCache()
+{
+    flush();
+    m_dataFile.close();
+}
+
+QString PersistentChunkCache::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/chunks";
+}
+
+void PersistentChunkCache::trimDirectory(const QString &directory, qint64 maxSize, const QString &keepKey)
+{
+    QDir dir(directory);
+    if (!dir.exists()) {
+        return;
+    }
+
+    // Oldest first
+    const QFileInfoList dataFiles = dir.entryInfoList(QStringList() << "*.chunks", QDir::Files, QDir::Time | QDir::Reversed);
+    qint64 totalSize = 0;
+    for (const QFileInfo &dataFile : dataFiles) {
+        if (dataFile.completeBaseName() != keepKey) {
+            totalSize += dataFile.size() + QFileInfo(dir.filePath(dataFile.completeBaseName() + ".index")).size();
+        }
+    }
+
+    for (const QFileInfo &dataFile : dataFiles) {
+        if (totalSize <= maxSize) {
+            break;
+        }
+        const QString key = dataFile.completeBaseName();
+        if (key == keepKey) {
+            continue;
+        }
+        const QString indexPath = dir.filePath(key + ".index");
+        const qint64 size = dataFile.size() + QFileInfo(indexPath).size();
+        // A cache still open in another tab can not be removed on every platform
+        if (!QFile::remove(dataFile.absoluteFilePath())) {
+            qDebug() << "Failed to remove chunk cache" << dataFile.absoluteFilePath();
+            continue;
+        }
+        QFile::remove(indexPath);
+        totalSize -= size;
+        qDebug() << "Removed chunk cache" << key << "to stay within" << maxSize << "bytes";
+    }
+}
+
+bool PersistentChunkCache::open()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_chunkSize <= 0 || !QDir().mkpath(QFileInfo(m_dataPath).absolutePath())) {
+        return false;
+    }
+    if (!m_dataFile.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open chunk cache" << m_dataPath << ":" << m_dataFile.errorString();
+        return false;
+    }
+
+    m_slots = QVector<Slot>(m_slotCount);
+    if (!loadIndex()) {
+        // Unknown or mismatching index, start over
+        m_slots = QVector<Slot>(m_slotCount);
+        m_lookup.clear();
+        m_freeSlots.clear();
+        m_nextUnused = 0;
+        m_head = -1;
+        m_tail = -1;
+        m_dataFile.resize(0);
+    } else if (m_dataFile.size() > m_slotCount * m_chunkSize) {
+        // The cache was made smaller, give back the slots it no longer uses
+        if (!m_dataFile.resize(m_slotCount * m_chunkSize)) {
+            qDebug() << "Failed to shrink chunk cache" << m_dataPath << ":" << m_dataFile.errorString();
+        }
+    }
+    qDebug() << "Chunk cache" << m_dataPath << "holds" << m_lookup.size() << "chunks";
+    return true;
+}
+
+// 64-bit FNV-1a over words, fast enough to run on every chunk read back from disk
+quint64 PersistentChunkCache::checksum(const char *data, qint64 length)
+{
+    quint64 hash = 14695981039346656037ULL;
+    qint64 i = 0;
+    for (; i + 8 <= length; i += 8) {
+        quint64 word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < length; ++i) {
+        hash = (hash ^ static_cast<uchar>(data[i])) * 1099511628211ULL;
+    }
+    return hash ^ static_cast<quint64>(length);
+}
+
+void PersistentChunkCache::unlink(int slot)
+{
+    Slot &entry = m_slots[slot];
+    if (entry.prev >= 0) {
+        m_slots[entry.prev].next = entry.next;
+    } else {
+        m_head = entry.next;
+    }
+    if (entry.next >= 0) {
+        m_slots[entry.next].prev = entry.prev;
+    } else {
+        m_tail = entry.prev;
+    }
+    entry.prev = -1;
+    entry.next = -1;
+}
+
+void PersistentChunkCache::pushFront(int slot)
+{
+    Slot &entry = m_slots[slot];
+    entry.prev = -1;
+    entry.next = m_head;
+    if (m_head >= 0) {
+        m_slots[m_head].prev = slot;
+    } else {
+        m_tail = slot;
+    }
+    m_head = slot;
+}
+
+// Free slots first, then slots never written, then the least recently used chunk
+int PersistentChunkCache::takeSlot()
+{
+    if (!m_freeSlots.isEmpty()) {
+        return m_freeSlots.takeLast();
+    }
+    if (m_nextUnused < m_slotCount) {
+        return m_nextUnused++;
+    }
+
+    const int slot = m_tail;
+    m_lookup.remove(m_slots.at(slot).chunkIndex);
+    unlink(slot);
+    m_slots[slot].chunkIndex = -1;
+    return slot;
+}
+
+void PersistentChunkCache::dropSlot(int slot)
+{
+    m_lookup.remove(m_slots.at(slot).chunkIndex);
+    unlink(slot);
+    m_slots[slot].chunkIndex = -1;
+    m_freeSlots.append(slot);
+}
+
+bool PersistentChunkCache::read(qint64 chunkIndex, QByteArray &data)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_dataFile.isOpen()) {
+        return false;
+    }
+
+    const auto it = m_lookup.constFind(chunkIndex);
+    if (it == m_lookup.constEnd()) {
+        return false;
+    }
+    const int slot = it.value();
+    const Slot &entry = m_slots.at(slot);
+
+    data.resize(entry.length);
+    if (!m_dataFile.seek(slot * m_chunkSize)
+        || m_dataFile.read(data.data(), entry.length) != entry.length
+        || checksum(data.constData(), entry.length) != entry.checksum) {
+        qDebug() << "Chunk cache: dropping unverifiable chunk" << chunkIndex;
+        dropSlot(slot);
+        data.clear();
+        return false;
+    }
+
+    unlink(slot);
+    pushFront(slot);
+    return true;
+}
+
+void PersistentChunkCache::write(qint64 chunkIndex, const QByteArray &data)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_dataFile.isOpen() || data.isEmpty() || data.size() > m_chunkSize || m_lookup.contains(chunkIndex)) {
+        return;
+    }
+
+    const int slot = takeSlot();
+    if (!m_dataFile.seek(slot * m_chunkSize) || m_dataFile.write(data) != data.size()) {
+        qDebug() << "Chunk cache: failed to write chunk" << chunkIndex << ":" << m_dataFile.errorString();
+        m_freeSlots.append(slot);
+        return;
+    }
+
+    Slot &entry = m_slots[slot];
+    entry.chunkIndex = chunkIndex;
+    entry.length = static_cast<quint32>(data.size());
+    entry.checksum = checksum(data.constData(), data.size());
+    m_lookup.insert(chunkIndex, slot);
+    pushFront(slot);
+
+    if (++m_writesSinceSave >= WritesPerIndexSave) {
+        saveIndex();
+    }
+}
+
+void PersistentChunkCache::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_dataFile.isOpen() && m_writesSinceSave > 0) {
+        m_dataFile.flush();
+        saveIndex();
+    }
+}
+
+// Entries are stored from least to most recently used so loading restores the LRU order
+bool PersistentChunkCache::saveIndex()
+{
+    QSaveFile file(m_indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Chunk cache: failed to save index:" << file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << IndexMagic << IndexVersion << m_chunkSize << static_cast<qint32>(m_lookup.size());
+    for (int slot = m_tail; slot >= 0; slot = m_slots.at(slot).prev) {
+        const Slot &entry = m_slots.at(slot);
+        out << static_cast<qint32>(slot) << entry.chunkIndex << entry.length << entry.checksum;
+    }
+
+    if (!file.commit()) {
+        qDebug() << "Chunk cache: failed to save index:" << file.errorString();
+        return false;
+    }
+    m_writesSinceSave = 0;
+    return true;
+}
+
+bool PersistentChunkCache::loadIndex()
+{
+    QFile file(m_indexPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 chunkSize = 0;
+    qint32 count = 0;
+    in >> magic >> version >> chunkSize >> count;
+    if (in.status() != QDataStream::Ok || magic != IndexMagic || version != IndexVersion
+        || chunkSize != m_chunkSize || count < 0) {
+        return false;
+    }
+
+    const qint64 dataSize = m_dataFile.size();
+    int highestSlot = -1;
+    for (qint32 i = 0; i < count; ++i) {
+        qint32 slot = -1;
+        Slot entry;
+        in >> slot >> entry.chunkIndex >> entry.length >> entry.checksum;
+        if (in.status() != QDataStream::Ok) {
+            return false;
+        }
+
+        // Entries outside a smaller cache or past the end of the data file are dropped
+        if (slot < 0 || slot >= m_slotCount || m_slots.at(slot).chunkIndex >= 0
+            || entry.chunkIndex < 0 || entry.length == 0 || entry.length > m_chunkSize
+            || slot * m_chunkSize + entry.length > dataSize || m_lookup.contains(entry.chunkIndex)) {
+            continue;
+        }
+
+        m_slots[slot] = entry;
+        m_lookup.insert(entry.chunkIndex, slot);
+        pushFront(slot);
+        highestSlot = qMax(highestSlot, static_cast<int>(slot));
+    }
+
+    m_nextUnused = highestSlot + 1;
+    for (int slot = 0; slot < m_nextUnused; ++slot) {
+        if (m_slots.at(slot).chunkIndex < 0) {
+            m_freeSlots.append(slot);
+        }
+    }
+    return true;
+}
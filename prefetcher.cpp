@@ -0,0 +1,192 @@
+#include "headers/prefetcher.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <algorithm>
+
+namespace {
+const qint64 DefaultBlockSize = 256 * 1024;
+// A block taking longer than this is dominated by latency, larger requests amortize it
+const qint64 HighLatencyMs = 40;
+const qint64 LowLatencyMs = 5;
+// Viewport moves faster than this (bytes per millisecond) use the full read-ahead
+const qint64 FastScrollRate = 64 * 1024;
+}
+
+Prefetcher::Prefetcher(QObject *parent)
+    : QObject(parent),
+    m_source(nullptr),
+    m_mediaSize(0),
+    m_generation(0),
+    m_lastStart(0),
+    m_direction(1),
+    m_prefetchedFrom(0),
+    m_prefetchedTo(0),
+    m_maxBlocksAhead(8),
+    m_blockSize(DefaultBlockSize)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+Prefetcher::~Prefetcher()
+{
+    m_generation.fetchAndAddOrdered(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void Prefetcher::setSource(EvidenceSource *source)
+{
+    m_generation.fetchAndAddOrdered(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+
+    m_source = source;
+    m_mediaSize = source ? source->mediaSize() : 0;
+    m_lastStart = 0;
+    m_direction = 1;
+    m_prefetchedFrom = 0;
+    m_prefetchedTo = 0;
+    m_moveTimer.invalidate();
+}
+
+void Prefetcher::setMaxBlocksAhead(int blocks)
+{
+    m_maxBlocksAhead = qMax(1, blocks);
+}
+
+qint64 Prefetcher::blockSize() const
+{
+    QMutexLocker locker(&m_blockSizeMutex);
+    return m_blockSize;
+}
+
+void Prefetcher::viewportMoved(quint64 start, quint64 length)
+{
+    if (!m_source || start == m_lastStart) {
+        return;
+    }
+
+    const qint64 elapsedMs = m_moveTimer.isValid() ? qMax<qint64>(1, m_moveTimer.restart()) : 0;
+    if (!m_moveTimer.isValid()) {
+        m_moveTimer.start();
+    }
+
+    const quint64 distance = start > m_lastStart ? start - m_lastStart : m_lastStart - start;
+    const int direction = start > m_lastStart ? 1 : -1;
+    m_lastStart = start;
+
+    // A long jump (go to offset, search hit) is not a reading direction yet
+    if (elapsedMs == 0 || distance > static_cast<quint64>(blockSize() * m_maxBlocksAhead)) {
+        m_prefetchedFrom = m_prefetchedTo = 0;
+        return;
+    }
+
+    if (direction != m_direction) {
+        // Work queued for the old direction is no longer useful
+        m_generation.fetchAndAddOrdered(1);
+        m_pool.clear();
+        m_direction = direction;
+        m_prefetchedFrom = m_prefetchedTo = 0;
+    }
+
+    // Slow paging only needs the next block, fast scrolling the whole read-ahead
+    const qint64 rate = static_cast<qint64>(distance) / elapsedMs;
+    const int blocksAhead = qBound(1, static_cast<int>(m_maxBlocksAhead * rate / FastScrollRate), m_maxBlocksAhead);
+    const quint64 reach = static_cast<quint64>(blocksAhead) * blockSize();
+
+    if (direction > 0) {
+        const quint64 from = start + length;
+        schedule(from, qMin<quint64>(from + reach, m_mediaSize));
+    } else {
+        schedule(start > reach ? start - reach : 0, start);
+    }
+}
+
+void Prefetcher::prefetchAround(quint64 offset)
+{
+    if (!m_source || offset >= static_cast<quint64>(m_mediaSize)) {
+        return;
+    }
+
+    const quint64 size = blockSize();
+    const quint64 from = offset > size ? offset - size : 0;
+    schedule(from, qMin<quint64>(offset + size, m_mediaSize));
+}
+
+void Prefetcher::schedule(quint64 from, quint64 to)
+{
+    const quint64 size = blockSize();
+
+    // Requests are aligned to the block size so that they line up with cache pages
+    from = (from / size) * size;
+    to = qMin<quint64>(((to + size - 1) / size) * size, m_mediaSize);
+
+    // Skip the part that is already queued, [m_prefetchedFrom, m_prefetchedTo) is contiguous
+    const bool overlaps = m_prefetchedFrom < m_prefetchedTo && from <= m_prefetchedTo && to >= m_prefetchedFrom;
+    if (overlaps) {
+        if (from >= m_prefetchedFrom && to <= m_prefetchedTo) {
+            return;
+        }
+        if (from >= m_prefetchedFrom) {
+            from = m_prefetchedTo;
+        } else if (to <= m_prefetchedTo) {
+            to = m_prefetchedFrom;
+        }
+        m_prefetchedFrom = qMin(m_prefetchedFrom, from);
+        m_prefetchedTo = qMax(m_prefetchedTo, to);
+    } else {
+        m_prefetchedFrom = from;
+        m_prefetchedTo = to;
+    }
+
+    if (from >= to) {
+        return;
+    }
+
+    const quint64 generation = m_generation.loadAcquire();
+
+    // Blocks nearest to the viewport are queued first
+    QList<quint64> blocks;
+    for (quint64 block = from; block < to; block += size) {
+        blocks.append(block);
+    }
+    if (m_direction < 0) {
+        std::reverse(blocks.begin(), blocks.end());
+    }
+
+    for (quint64 block : blocks) {
+        const qint64 length = qMin<qint64>(size, m_mediaSize - block);
+        m_pool.start([this, generation, block, length]() {
+            prefetchBlock(generation, block, length);
+        });
+    }
+}
+
+void Prefetcher::prefetchBlock(quint64 generation, quint64 blockStart, qint64 length)
+{
+    if (m_generation.loadAcquire() != generation || !m_source) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    m_source->prefetch(blockStart, length);
+    adaptBlockSize(length, timer.elapsed());
+}
+
+void Prefetcher::adaptBlockSize(qint64 length, qint64 elapsedMs)
+{
+    QMutexLocker locker(&m_blockSizeMutex);
+
+    // Only blocks of the current size say something about the current size
+    if (length != m_blockSize) {
+        return;
+    }
+
+    if (elapsedMs > HighLatencyMs && m_blockSize < MaxBlockSize) {
+        m_blockSize *= 2;
+        qDebug() << "Prefetch block size raised to" << m_blockSize << "after" << elapsedMs << "ms read";
+    } else if (elapsedMs < LowLatencyMs && m_blockSize > DefaultBlockSize) {
+        m_blockSize /= 2;
+    }
+}
@@ -24,3 +24,7 @@ QString searchform::getSearchType() const {
 QPushButton* searchform::getSearchButton() const {
     return ui->searchButton;
 }
+
+QPushButton* searchform::getFindAllButton() const {
+    return ui->findAllButton;
+}
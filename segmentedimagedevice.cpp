@@ -0,0 +1,195 @@
+#include "headers/segmentedimagedevice.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <algorithm>
+
+SegmentedImageDevice::SegmentedImageDevice(const QString &firstSegmentPath, QObject *parent)
+    : QIODevice(parent),
+    m_firstSegmentPath(firstSegmentPath),
+    m_maxOpenSegments(DefaultMaxOpenSegments)
+{
+}
+
+SegmentedImageDevice::~SegmentedImageDevice()
+{
+    QIODevice::close();
+}
+
+bool SegmentedImageDevice::isSegmentedImagePath(const QString &filePath)
+{
+    const QString suffix = QFileInfo(filePath).suffix();
+    if (suffix.size() < 3) {
+        return false;
+    }
+    return std::all_of(suffix.begin(), suffix.end(), [](QChar c) { return c.isDigit(); });
+}
+
+bool SegmentedImageDevice::discoverSegments()
+{
+    QFileInfo firstInfo(m_firstSegmentPath);
+    const QString suffix = firstInfo.suffix();
+    const int width = suffix.size();
+    const QString base = m_firstSegmentPath.left(m_firstSegmentPath.size() - width);
+
+    // Acquisition tools number from .001 (sometimes .000), whichever segment was opened
+    int number = QFileInfo::exists(base + QString("%1").arg(0, width, 10, QChar('0'))) ? 0 : 1;
+
+    m_segmentPaths.clear();
+    m_segmentStarts.clear();
+    qint64 offset = 0;
+
+    while (true) {
+        const QString path = base + QString("%1").arg(number, width, 10, QChar('0'));
+        QFileInfo info(path);
+        if (!info.exists()) {
+            break;
+        }
+
+        m_segmentPaths.append(path);
+        m_segmentStarts.append(offset);
+        offset += info.size();
+        ++number;
+    }
+    m_segmentStarts.append(offset);
+
+    qDebug() << "Found" << m_segmentPaths.size() << "segments, total size" << offset;
+    return !m_segmentPaths.isEmpty() && m_segmentPaths.contains(m_firstSegmentPath);
+}
+
+bool SegmentedImageDevice::open(OpenMode mode)
+{
+    if (mode & QIODevice::WriteOnly) {
+        qDebug() << "Segmented images can only be opened for reading.";
+        return false;
+    }
+
+    if (!discoverSegments()) {
+        qCritical() << "Failed to discover the segments of" << m_firstSegmentPath;
+        return false;
+    }
+
+    // Fail early if the first segment can not be read
+    if (!segmentFile(0)) {
+        return false;
+    }
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+qint64 SegmentedImageDevice::size() const
+{
+    return m_segmentStarts.isEmpty() ? 0 : m_segmentStarts.last();
+}
+
+qint64 SegmentedImageDevice::mediaSize() const
+{
+    return size();
+}
+
+int SegmentedImageDevice::segmentCount() const
+{
+    return m_segmentPaths.size();
+}
+
+QStringList SegmentedImageDevice::segmentPaths() const
+{
+    return m_segmentPaths;
+}
+
+void SegmentedImageDevice::setMaxOpenSegments(int count)
+{
+    QMutexLocker locker(&m_poolMutex);
+    m_maxOpenSegments = qMax(1, count);
+}
+
+int SegmentedImageDevice::segmentForOffset(qint64 offset) const
+{
+    // Last segment start that is <= offset
+    auto it = std::upper_bound(m_segmentStarts.begin(), m_segmentStarts.end() - 1, offset);
+    return static_cast<int>(it - m_segmentStarts.begin()) - 1;
+}
+
+QSharedPointer<EvidenceFile> SegmentedImageDevice::segmentFile(int segment)
+{
+    QMutexLocker locker(&m_poolMutex);
+
+    QSharedPointer<EvidenceFile> file = m_openSegments.value(segment);
+    if (file) {
+        m_recentSegments.removeOne(segment);
+        m_recentSegments.append(segment);
+        return file;
+    }
+
+    file.reset(new EvidenceFile(m_segmentPaths.at(segment)));
+    if (!file->open(QIODevice::ReadOnly)) {
+        qCritical() << "Failed to open segment" << m_segmentPaths.at(segment);
+        return QSharedPointer<EvidenceFile>();
+    }
+
+    // Readers still holding an evicted segment keep it alive until they are done
+    while (m_recentSegments.size() >= m_maxOpenSegments) {
+        m_openSegments.remove(m_recentSegments.takeFirst());
+    }
+
+    m_openSegments.insert(segment, file);
+    m_recentSegments.append(segment);
+    return file;
+}
+
+qint64 SegmentedImageDevice::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    if (offset < 0 || maxlen < 0) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= size()) {
+        return 0;
+    }
+
+    IoStatistics::ReadTimer timer(m_statistics);
+    const qint64 bytesToRead = qMin(maxlen, size() - offset);
+    qint64 bytesRead = 0;
+    int segment = segmentForOffset(offset);
+
+    // A read crossing segment boundaries is completed here, not left to the caller
+    while (bytesRead < bytesToRead && segment < m_segmentPaths.size()) {
+        const qint64 position = offset + bytesRead;
+        const qint64 segmentOffset = position - m_segmentStarts.at(segment);
+        const qint64 segmentRemaining = m_segmentStarts.at(segment + 1) - position;
+        const qint64 length = qMin(bytesToRead - bytesRead, segmentRemaining);
+        if (length <= 0) {
+            ++segment; // Empty segment
+            continue;
+        }
+
+        QSharedPointer<EvidenceFile> file = segmentFile(segment);
+        if (!file) {
+            break;
+        }
+
+        const qint64 count = file->readAt(segmentOffset, data + bytesRead, length);
+        if (count <= 0) {
+            break;
+        }
+        bytesRead += count;
+        if (count < length) {
+            break; // Segment shorter than when it was indexed
+        }
+        ++segment;
+    }
+
+    return timer.finish(bytesRead > 0 ? bytesRead : -1);
+}
+
+qint64 SegmentedImageDevice::readData(char *data, qint64 maxlen)
+{
+    return readAt(QIODevice::pos(), data, maxlen);
+}
+
+qint64 SegmentedImageDevice::writeData(const char *data, qint64 len)
+{
+    // Writing is not supported for this device.
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
@@ -0,0 +1,459 @@
+#include "headers/sparsemap.h"
+#include "headers/bufferedevidencedevice.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPARSEMAP_SSE2
+#endif
+
+namespace {
+const qint64 BlocksPerWord = 64;
+const quint32 MapFileMagic = 0x53504d31; // "SPM1"
+const quint32 MapFileVersion = 1;
+// How often the scan tells the views to repaint
+const qint64 UpdateIntervalMs = 500;
+
+quint64 validBits(qint64 count)
+{
+    return count >= BlocksPerWord ? ~quint64(0) : ((quint64(1) << count) - 1);
+}
+
+QByteArray bitmapChecksum(const QVector<quint64> &empty, const QVector<quint64> &scanned)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::fromRawData(reinterpret_cast<const char *>(empty.constData()), empty.size() * sizeof(quint64)));
+    hash.addData(QByteArray::fromRawData(reinterpret_cast<const char *>(scanned.constData()), scanned.size() * sizeof(quint64)));
+    return hash.result();
+}
+}
+
+SparseMap::SparseMap(QObject *parent)
+    : QObject(parent),
+    m_source(nullptr),
+    m_mediaSize(0),
+    m_blockCount(0),
+    m_generation(0),
+    m_scanning(0),
+    m_dirty(false)
+{
+    m_pool.setMaxThreadCount(1);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    // The scan must not compete with the viewport reads
+    m_pool.setThreadPriority(QThread::LowPriority);
+#endif
+}
+
+SparseMap::~SparseMap()
+{
+    stop();
+}
+
+void SparseMap::start(EvidenceSource *source, const QString &path)
+{
+    stop();
+    if (!source) {
+        return;
+    }
+
+    m_source = source;
+    m_path = path;
+    m_mediaSize = source->mediaSize();
+    m_blockCount = (m_mediaSize + BlockSize - 1) / BlockSize;
+
+    const qint64 wordCount = (m_blockCount + BlocksPerWord - 1) / BlocksPerWord;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_empty.fill(0, wordCount);
+        m_scanned.fill(0, wordCount);
+        m_fullWords.fill(0, (wordCount + BlocksPerWord - 1) / BlocksPerWord);
+        m_anyWords.fill(0, m_fullWords.size());
+        m_dirty = false;
+    }
+
+    if (load()) {
+        emit updated();
+    }
+
+    const quint64 generation = m_generation.loadAcquire();
+    m_scanning.storeRelease(1);
+    m_pool.start([this, generation]() {
+        scan(generation);
+    });
+}
+
+void SparseMap::stop()
+{
+    m_generation.fetchAndAddOrdered(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+    m_scanning.storeRelease(0);
+
+    if (m_source) {
+        save();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_source = nullptr;
+    m_mediaSize = 0;
+    m_blockCount = 0;
+    m_empty.clear();
+    m_scanned.clear();
+    m_fullWords.clear();
+    m_anyWords.clear();
+}
+
+// Scans 64 blocks (one bitmap word) per read, skipping words a saved map already covers
+void SparseMap::scan(quint64 generation)
+{
+    QByteArray buffer(BlocksPerWord * BlockSize, Qt::Uninitialized);
+    // Reads the next word while the current one is checked for zeros. Every block
+    // is read once, so it goes past the chunk caches the hex view relies on.
+    BufferedEvidenceDevice::Policy policy = BufferedEvidenceDevice::Policy::streaming();
+    policy.uncached = true;
+    BufferedEvidenceDevice reader(m_source, policy);
+    reader.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    QElapsedTimer updateTimer;
+    updateTimer.start();
+
+    const qint64 wordCount = (m_blockCount + BlocksPerWord - 1) / BlocksPerWord;
+    for (qint64 word = 0; word < wordCount; ++word) {
+        if (m_generation.loadAcquire() != generation) {
+            return;
+        }
+
+        const qint64 wordBlocks = qMin(BlocksPerWord, m_blockCount - word * BlocksPerWord);
+        const quint64 valid = validBits(wordBlocks);
+        {
+            QMutexLocker locker(&m_mutex);
+            if ((m_scanned.at(word) & valid) == valid) {
+                continue;
+            }
+        }
+
+        const qint64 wordStart = word * BlocksPerWord * BlockSize;
+        const qint64 length = qMin(BlocksPerWord * BlockSize, m_mediaSize - wordStart);
+        qint64 bytesRead = 0;
+        while (bytesRead < length) {
+            const qint64 count = reader.readAt(wordStart + bytesRead, buffer.data() + bytesRead, length - bytesRead);
+            if (count <= 0) {
+                break;
+            }
+            bytesRead += count;
+        }
+
+        // Blocks that could not be read stay unscanned and count as data
+        quint64 emptyBits = 0;
+        quint64 scannedBits = 0;
+        for (qint64 block = 0; block < wordBlocks; ++block) {
+            const qint64 blockStart = block * BlockSize;
+            const qint64 blockLength = qMin(BlockSize, length - blockStart);
+            if (blockStart + blockLength > bytesRead) {
+                break;
+            }
+            scannedBits |= quint64(1) << block;
+            if (isZeroBlock(buffer.constData() + blockStart, blockLength)) {
+                emptyBits |= quint64(1) << block;
+            }
+        }
+        markWord(word, emptyBits, scannedBits);
+
+        if (updateTimer.elapsed() >= UpdateIntervalMs) {
+            emit updated();
+            updateTimer.restart();
+        }
+    }
+
+    m_scanning.storeRelease(0);
+    emit updated();
+    save();
+}
+
+void SparseMap::markWord(qint64 word, quint64 emptyBits, quint64 scannedBits)
+{
+    QMutexLocker locker(&m_mutex);
+    m_empty[word] = (m_empty.at(word) & ~scannedBits) | emptyBits;
+    m_scanned[word] |= scannedBits;
+    m_dirty = true;
+    updateSummary(word);
+}
+
+// Caller must hold m_mutex
+void SparseMap::updateSummary(qint64 word)
+{
+    const quint64 bit = quint64(1) << (word % BlocksPerWord);
+    const qint64 summaryWord = word / BlocksPerWord;
+    const quint64 bits = m_empty.at(word);
+
+    if (bits == ~quint64(0)) {
+        m_fullWords[summaryWord] |= bit;
+    } else {
+        m_fullWords[summaryWord] &= ~bit;
+    }
+    if (bits != 0) {
+        m_anyWords[summaryWord] |= bit;
+    } else {
+        m_anyWords[summaryWord] &= ~bit;
+    }
+}
+
+bool SparseMap::isZeroBlock(const char *data, qint64 length)
+{
+    qint64 i = 0;
+
+#ifdef SPARSEMAP_SSE2
+    // OR 1 KB at a time and test, data blocks usually fail in the first few bytes
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 1024 <= length) {
+        __m128i acc = zero;
+        for (const qint64 end = i + 1024; i < end; i += 64) {
+            const __m128i *p = reinterpret_cast<const __m128i *>(data + i);
+            acc = _mm_or_si128(acc, _mm_or_si128(_mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+                                                 _mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3))));
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+
+    quint64 acc = 0;
+    for (; i + 8 <= length; i += 8) {
+        quint64 word;
+        memcpy(&word, data + i, sizeof(word));
+        acc |= word;
+        if (acc) {
+            return false;
+        }
+    }
+    for (; i < length; ++i) {
+        if (data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SparseMap::isEmptyBlock(qint64 offset) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (offset < 0 || offset >= m_mediaSize) {
+        return false;
+    }
+    const qint64 block = offset / BlockSize;
+    return (m_empty.at(block / BlocksPerWord) >> (block % BlocksPerWord)) & 1;
+}
+
+bool SparseMap::isScanned(qint64 offset) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (offset < 0 || offset >= m_mediaSize) {
+        return false;
+    }
+    const qint64 block = offset / BlockSize;
+    return (m_scanned.at(block / BlocksPerWord) >> (block % BlocksPerWord)) & 1;
+}
+
+bool SparseMap::isScanning() const
+{
+    return m_scanning.loadAcquire() != 0;
+}
+
+bool SparseMap::hasEmptyBlocks() const
+{
+    QMutexLocker locker(&m_mutex);
+    for (quint64 bits : m_anyWords) {
+        if (bits) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 SparseMap::nextNonEmpty(qint64 offset) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (offset < 0 || offset >= m_mediaSize) {
+        return m_mediaSize;
+    }
+    const qint64 block = findBlock(offset / BlockSize, false);
+    return block == offset / BlockSize ? offset : qMin(block * BlockSize, m_mediaSize);
+}
+
+qint64 SparseMap::nextEmpty(qint64 offset) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (offset < 0 || offset >= m_mediaSize) {
+        return m_mediaSize;
+    }
+    const qint64 block = findBlock(offset / BlockSize, true);
+    return block == offset / BlockSize ? offset : qMin(block * BlockSize, m_mediaSize);
+}
+
+// First block at or after block whose empty bit equals empty, m_blockCount if there
+// is none. Whole words are skipped through the summary. Caller must hold m_mutex.
+qint64 SparseMap::findBlock(qint64 block, bool empty) const
+{
+    const qint64 wordCount = m_empty.size();
+    qint64 word = block / BlocksPerWord;
+
+    quint64 bits = empty ? m_empty.at(word) : ~m_empty.at(word);
+    bits &= ~quint64(0) << (block % BlocksPerWord);
+    if (bits) {
+        return qMin(word * BlocksPerWord + qCountTrailingZeroBits(bits), m_blockCount);
+    }
+
+    ++word;
+    for (qint64 summaryWord = word / BlocksPerWord; word < wordCount && summaryWord < m_fullWords.size(); ++summaryWord) {
+        quint64 summary = empty ? m_anyWords.at(summaryWord) : ~m_fullWords.at(summaryWord);
+        if (summaryWord == word / BlocksPerWord) {
+            summary &= ~quint64(0) << (word % BlocksPerWord);
+        }
+        if (summary) {
+            word = summaryWord * BlocksPerWord + qCountTrailingZeroBits(summary);
+            if (word >= wordCount) {
+                break;
+            }
+            bits = empty ? m_empty.at(word) : ~m_empty.at(word);
+            return qMin(word * BlocksPerWord + qCountTrailingZeroBits(bits), m_blockCount);
+        }
+    }
+    return m_blockCount;
+}
+
+// Caller must hold m_mutex
+qint64 SparseMap::countEmpty(qint64 firstBlock, qint64 endBlock) const
+{
+    qint64 count = 0;
+    qint64 block = firstBlock;
+    while (block < endBlock) {
+        const qint64 word = block / BlocksPerWord;
+        const qint64 bit = block % BlocksPerWord;
+        const qint64 bitCount = qMin(BlocksPerWord - bit, endBlock - block);
+        const quint64 bits = (m_empty.at(word) >> bit) & validBits(bitCount);
+        count += qPopulationCount(bits);
+        block += bitCount;
+    }
+    return count;
+}
+
+QVector<quint8> SparseMap::emptyProfile(int buckets) const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<quint8> profile(qMax(buckets, 0), 0);
+    if (m_blockCount == 0) {
+        return profile;
+    }
+
+    for (int i = 0; i < profile.size(); ++i) {
+        const qint64 firstBlock = m_blockCount * i / profile.size();
+        const qint64 endBlock = qMax(firstBlock + 1, m_blockCount * (i + 1) / profile.size());
+        profile[i] = static_cast<quint8>(countEmpty(firstBlock, qMin(endBlock, m_blockCount)) * 255 / (endBlock - firstBlock));
+    }
+    return profile;
+}
+
+// Maps are only kept for image files, a drive or device can change between sessions
+QString SparseMap::mapFilePath() const
+{
+    QFileInfo info(m_path);
+    if (!info.isFile()) {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(info.canonicalFilePath().toUtf8());
+    hash.addData(QByteArray::number(m_mediaSize));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + "/sparsemaps/" + QString::fromLatin1(hash.result().toHex()) + ".map";
+}
+
+bool SparseMap::load()
+{
+    const QString mapPath = mapFilePath();
+    if (mapPath.isEmpty()) {
+        return false;
+    }
+
+    QFile file(mapPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 mediaSize = 0;
+    qint64 blockSize = 0;
+    QVector<quint64> empty;
+    QVector<quint64> scanned;
+    QByteArray checksum;
+    in >> magic >> version >> mediaSize >> blockSize >> empty >> scanned >> checksum;
+
+    QMutexLocker locker(&m_mutex);
+    if (in.status() != QDataStream::Ok || magic != MapFileMagic || version != MapFileVersion
+        || mediaSize != m_mediaSize || blockSize != BlockSize
+        || empty.size() != m_empty.size() || scanned.size() != m_scanned.size()) {
+        qDebug() << "Ignoring stale sparse map" << mapPath;
+        return false;
+    }
+
+    if (bitmapChecksum(empty, scanned) != checksum) {
+        qDebug() << "Ignoring corrupt sparse map" << mapPath;
+        return false;
+    }
+
+    m_empty = empty;
+    m_scanned = scanned;
+    for (qint64 word = 0; word < m_empty.size(); ++word) {
+        m_empty[word] &= m_scanned.at(word);
+        updateSummary(word);
+    }
+    return true;
+}
+
+void SparseMap::save()
+{
+    const QString mapPath = mapFilePath();
+    if (mapPath.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_dirty) {
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(mapPath).absolutePath());
+    QSaveFile file(mapPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to save sparse map:" << file.errorString();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << MapFileMagic << MapFileVersion << m_mediaSize << BlockSize << m_empty << m_scanned
+        << bitmapChecksum(m_empty, m_scanned);
+
+    if (!file.commit()) {
+        qDebug() << "Failed to save sparse map:" << file.errorString();
+        return;
+    }
+    m_dirty = false;
+}
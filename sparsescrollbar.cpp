@@ -0,0 +1,53 @@
+#include "headers/sparsescrollbar.h"
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionSlider>
+
+namespace {
+// Width of the strip drawn along the right edge of the groove
+const int MarkerWidth = 4;
+}
+
+SparseScrollBar::SparseScrollBar(QWidget *parent)
+    : QScrollBar(Qt::Vertical, parent)
+{
+}
+
+void SparseScrollBar::setSparseMap(SparseMap *map)
+{
+    if (m_map) {
+        disconnect(m_map, nullptr, this, nullptr);
+    }
+    m_map = map;
+    if (m_map) {
+        connect(m_map, &SparseMap::updated, this, qOverload<>(&QWidget::update));
+    }
+    update();
+}
+
+void SparseScrollBar::paintEvent(QPaintEvent *event)
+{
+    QScrollBar::paintEvent(event);
+
+    if (!m_map || !m_map->hasEmptyBlocks()) {
+        return;
+    }
+
+    QStyleOptionSlider option;
+    initStyleOption(&option);
+    const QRect groove = style()->subControlRect(QStyle::CC_ScrollBar, &option, QStyle::SC_ScrollBarGroove, this);
+    if (groove.height() <= 0) {
+        return;
+    }
+
+    // One bucket per pixel row, the darker the row the more of it is empty
+    const QVector<quint8> profile = m_map->emptyProfile(groove.height());
+    QPainter painter(this);
+    for (int row = 0; row < profile.size(); ++row) {
+        if (profile.at(row) == 0) {
+            continue;
+        }
+        painter.fillRect(groove.right() - MarkerWidth + 1, groove.top() + row, MarkerWidth, 1,
+                         QColor(128, 128, 128, profile.at(row)));
+    }
+}
@@ -6,7 +6,7 @@
 #include <QDateTime>
 #include <QDebug>
 
-TagDialogModel::TagDialogModel(const QString &title, const QList<Tag> &tags, QIODevice &file, quint64 currentCursorPos, QWidget *parent, const QMap<QString, QList<Tag>> &tagsListByGroup)
+TagDialogModel::TagDialogModel(const QString &title, const QList<Tag> &tags, EvidenceSource &file, quint64 currentCursorPos, QWidget *parent, const QMap<QString, QList<Tag>> &tagsListByGroup)
     : QDialog(parent),
     tabWidget(new QTabWidget(this)),
     tableView(new QTableView(this)),
@@ -46,17 +46,47 @@ TagDialogModel::TagDialogModel(const QString &title, const QList<Tag> &tags, QIO
     }
 }
 
-void TagDialogModel::populateModel(const QList<Tag> &tags, QIODevice &file)
+// Reads the values of all tags with one batched read, failed reads are null
+QList<QByteArray> TagDialogModel::readTagData(const QList<Tag> &tags, EvidenceSource &file)
 {
+    QList<QByteArray> tagData(tags.size());
+    QList<EvidenceSource::ReadRequest> requests(tags.size());
+
+    for (int i = 0; i < tags.size(); ++i) {
+        tagData[i].resize(tags[i].length);
+        requests[i].offset = tags[i].offset + currentCursorPos;
+        requests[i].length = tags[i].length;
+        requests[i].data = tagData[i].data();
+    }
+
+    file.readv(requests);
+
+    for (int i = 0; i < tags.size(); ++i) {
+        if (requests[i].bytesRead < 0) {
+            tagData[i] = QByteArray();
+        } else {
+            tagData[i].resize(requests[i].bytesRead);
+            if (tagData[i].isNull()) {
+                tagData[i] = QByteArray("", 0); // Empty but readable
+            }
+        }
+    }
+    return tagData;
+}
+
+void TagDialogModel::populateModel(const QList<Tag> &tags, EvidenceSource &file)
+{
+    const QList<QByteArray> tagValues = readTagData(tags, file);
+    int tagIndex = 0;
+
     for (const Tag &tag : tags) {
+        const QByteArray &tagData = tagValues.at(tagIndex++);
         QList<QStandardItem *> row;
-        quint64 adjustedOffset = tag.offset + currentCursorPos;
         row.append(new QStandardItem(QString("0x%1").arg(tag.offset, 0, 16).toUpper()));
         row.append(new QStandardItem(QString::number(tag.offset)));
         row.append(new QStandardItem(QString::number(tag.length)));
 
-        if (file.seek(adjustedOffset)) {
-            QByteArray tagData = file.read(tag.length);
+        if (!tagData.isNull()) {
             QString value, valueHex;
 
             // Display hex as-is
@@ -132,7 +162,7 @@ void TagDialogModel::populateModel(const QList<Tag> &tags, QIODevice &file)
     }
 }
 
-void TagDialogModel::populateModelByGroup(const QMap<QString, QList<Tag>> &tagsListByGroup, QIODevice &file)
+void TagDialogModel::populateModelByGroup(const QMap<QString, QList<Tag>> &tagsListByGroup, EvidenceSource &file)
 {
     for (const QString &groupName : tagsListByGroup.keys()) {
         QTableView *groupTableView = new QTableView(this);
@@ -150,15 +180,17 @@ void TagDialogModel::populateModelByGroup(const QMap<QString, QList<Tag>> &tagsL
         groupTableView->setSelectionBehavior(QAbstractItemView::SelectRows);
 
         const QList<Tag> &tags = tagsListByGroup.value(groupName);
+        const QList<QByteArray> tagValues = readTagData(tags, file);
+        int tagIndex = 0;
+
         for (const Tag &tag : tags) {
+            const QByteArray &tagData = tagValues.at(tagIndex++);
             QList<QStandardItem *> row;
-            quint64 adjustedOffset = tag.offset + currentCursorPos;
             row.append(new QStandardItem(QString("0x%1").arg(tag.offset, 0, 16).toUpper()));
             row.append(new QStandardItem(QString::number(tag.offset)));
             row.append(new QStandardItem(QString::number(tag.length)));
 
-            if (file.seek(adjustedOffset)) {
-                QByteArray tagData = file.read(tag.length);
+            if (!tagData.isNull()) {
                 QString value, valueHex;
 
                 // Display hex as-is
@@ -0,0 +1,132 @@
+#include "headers/tagindex.h"
+#include <algorithm>
+
+void TagIndex::invalidate()
+{
+    m_dirty = true;
+}
+
+void TagIndex::ensure(const QList<Tag> &tags)
+{
+    if (!m_dirty) {
+        return;
+    }
+    m_dirty = false;
+
+    m_entries.clear();
+    m_entries.reserve(tags.size());
+    for (int i = 0; i < tags.size(); ++i) {
+        const Tag &tag = tags.at(i);
+        if (tag.length == 0) {
+            continue; // Covers no byte
+        }
+        m_entries.append({tag.offset, tag.offset + tag.length, QColor(tag.color), i});
+    }
+
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry &a, const Entry &b) {
+        return a.start < b.start || (a.start == b.start && a.tagIndex < b.tagIndex);
+    });
+
+    m_maxEnd.resize(m_entries.size());
+    buildMaxEnd(0, m_entries.size());
+}
+
+// The subtree of [low, high) is rooted at its middle entry
+quint64 TagIndex::buildMaxEnd(int low, int high)
+{
+    if (low >= high) {
+        return 0;
+    }
+    const int middle = low + (high - low) / 2;
+    const quint64 left = buildMaxEnd(low, middle);
+    const quint64 right = buildMaxEnd(middle + 1, high);
+    m_maxEnd[middle] = std::max({m_entries.at(middle).end, left, right});
+    return m_maxEnd.at(middle);
+}
+
+// Appends the entries overlapping [from, to), in start order
+void TagIndex::collect(int low, int high, quint64 from, quint64 to, QVector<int> &found) const
+{
+    if (low >= high) {
+        return;
+    }
+    const int middle = low + (high - low) / 2;
+    if (m_maxEnd.at(middle) <= from) {
+        return; // Everything below ends before the range
+    }
+
+    collect(low, middle, from, to, found);
+    const Entry &entry = m_entries.at(middle);
+    if (entry.start >= to) {
+        return; // This entry and everything to its right start after the range
+    }
+    if (entry.end > from) {
+        found.append(middle);
+    }
+    collect(middle + 1, high, from, to, found);
+}
+
+int TagIndex::tagAt(quint64 offset) const
+{
+    QVector<int> found;
+    collect(0, m_entries.size(), offset, offset + 1, found);
+
+    int winner = -1;
+    for (int entry : found) {
+        const int tagIndex = m_entries.at(entry).tagIndex;
+        if (winner < 0 || tagIndex < winner) {
+            winner = tagIndex;
+        }
+    }
+    return winner;
+}
+
+// Sweeps the boundaries of the overlapping tags once, a row rarely has more than a few
+QVector<TagIndex::Span> TagIndex::spans(quint64 from, quint64 to) const
+{
+    QVector<Span> result;
+    if (from >= to) {
+        return result;
+    }
+
+    QVector<int> found;
+    collect(0, m_entries.size(), from, to, found);
+    if (found.isEmpty()) {
+        return result;
+    }
+
+    QVector<quint64> boundaries;
+    boundaries.reserve(found.size() * 2 + 2);
+    boundaries.append(from);
+    boundaries.append(to);
+    for (int entry : found) {
+        boundaries.append(qMax(from, m_entries.at(entry).start));
+        boundaries.append(qMin(to, m_entries.at(entry).end));
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    for (int i = 0; i + 1 < boundaries.size(); ++i) {
+        const quint64 start = boundaries.at(i);
+        const quint64 end = boundaries.at(i + 1);
+
+        const Entry *winner = nullptr;
+        for (int entry : found) {
+            const Entry &candidate = m_entries.at(entry);
+            if (candidate.start <= start && candidate.end >= end && (!winner || candidate.tagIndex < winner->tagIndex)) {
+                winner = &candidate;
+            }
+        }
+        if (!winner) {
+            continue;
+        }
+
+        // Neighbouring pieces of the same tag are merged back into one span
+        if (!result.isEmpty() && result.last().end == start && result.last().tagIndex == winner->tagIndex) {
+            result.last().end = end;
+        } else {
+            result.append({start, end, winner->color, winner->tagIndex});
+        }
+    }
+    return result;
+}
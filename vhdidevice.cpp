@@ -0,0 +1,59 @@
+#include "headers/vhdidevice.h"
+#include <QDebug>
+
+VhdiDevice::VhdiDevice(QObject *parent)
+    : ChunkedImageDevice(parent),
+    m_vhdiFile(nullptr)
+{
+}
+
+bool VhdiDevice::openVhdi(const char *vhdFilePath, OpenMode mode)
+{
+    libvhdi_error_t *error = nullptr;
+
+    if (libvhdi_file_initialize(&m_vhdiFile, &error) != 1) {
+        libvhdi_error_fprint(error, stderr);
+        libvhdi_error_free(&error);
+        return false;
+    }
+
+    if (libvhdi_file_open(m_vhdiFile, vhdFilePath, LIBVHDI_OPEN_READ, &error) != 1) {
+        libvhdi_error_fprint(error, stderr);
+        libvhdi_error_free(&error);
+        return false;
+    }
+
+    size64_t mediaSize = 0;
+    if (libvhdi_file_get_media_size(m_vhdiFile, &mediaSize, &error) != 1) {
+        libvhdi_error_fprint(error, stderr);
+        libvhdi_error_free(&error);
+        return false;
+    }
+
+    setGeometry(static_cast<qint64>(mediaSize), BlockSize);
+    qDebug() << "VHD media size is" << mediaSize;
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+VhdiDevice::~VhdiDevice()
+{
+    if (m_vhdiFile) {
+        libvhdi_file_close(m_vhdiFile, nullptr);
+        libvhdi_file_free(&m_vhdiFile, nullptr);
+    }
+}
+
+bool VhdiDevice::readChunkFromImage(qint64 offset, char *data, qint64 length)
+{
+    libvhdi_error_t *error = nullptr;
+
+    // Blocks missing from the block allocation table read as zeros
+    ssize_t read_count = libvhdi_file_read_buffer_at_offset(m_vhdiFile, data, static_cast<size_t>(length), offset, &error);
+    if (read_count != length) {
+        libvhdi_error_fprint(error, stderr);
+        libvhdi_error_free(&error);
+        return false;
+    }
+    return true;
+}
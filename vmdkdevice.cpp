@@ -0,0 +1,66 @@
+#include "headers/vmdkdevice.h"
+#include <QDebug>
+
+VmdkDevice::VmdkDevice(QObject *parent)
+    : ChunkedImageDevice(parent),
+    m_vmdkHandle(nullptr)
+{
+}
+
+bool VmdkDevice::openVmdk(const char *vmdkFilePath, OpenMode mode)
+{
+    libvmdk_error_t *error = nullptr;
+
+    if (libvmdk_handle_initialize(&m_vmdkHandle, &error) != 1) {
+        libvmdk_error_fprint(error, stderr);
+        libvmdk_error_free(&error);
+        return false;
+    }
+
+    if (libvmdk_handle_open(m_vmdkHandle, vmdkFilePath, LIBVMDK_OPEN_READ, &error) != 1) {
+        libvmdk_error_fprint(error, stderr);
+        libvmdk_error_free(&error);
+        return false;
+    }
+
+    // The descriptor only lists the extents, the grain data lives in the extent files
+    if (libvmdk_handle_open_extent_data_files(m_vmdkHandle, &error) != 1) {
+        libvmdk_error_fprint(error, stderr);
+        libvmdk_error_free(&error);
+        return false;
+    }
+
+    size64_t mediaSize = 0;
+    if (libvmdk_handle_get_media_size(m_vmdkHandle, &mediaSize, &error) != 1) {
+        libvmdk_error_fprint(error, stderr);
+        libvmdk_error_free(&error);
+        return false;
+    }
+
+    setGeometry(static_cast<qint64>(mediaSize), GrainSize);
+    qDebug() << "VMDK media size is" << mediaSize;
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+VmdkDevice::~VmdkDevice()
+{
+    if (m_vmdkHandle) {
+        libvmdk_handle_close(m_vmdkHandle, nullptr);
+        libvmdk_handle_free(&m_vmdkHandle, nullptr);
+    }
+}
+
+bool VmdkDevice::readChunkFromImage(qint64 offset, char *data, qint64 length)
+{
+    libvmdk_error_t *error = nullptr;
+
+    // Unallocated grains are filled with zeros by libvmdk without reading extent data
+    ssize_t read_count = libvmdk_handle_read_buffer_at_offset(m_vmdkHandle, data, static_cast<size_t>(length), offset, &error);
+    if (read_count != length) {
+        libvmdk_error_fprint(error, stderr);
+        libvmdk_error_free(&error);
+        return false;
+    }
+    return true;
+}
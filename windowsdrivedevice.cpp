@@ -1,9 +1,12 @@
 #include "headers/windowsdrivedevice.h"
+
+#ifdef Q_OS_WIN
+
 #include <QDebug>
 #include <QFileInfo>
 
 WindowsDriveDevice::WindowsDriveDevice(const QString &drivePath, QObject *parent)
-    : QIODevice(parent), hDevice(INVALID_HANDLE_VALUE), m_fileSize(0), bufferStartPos(0), bufferEndPos(0)
+    : QIODevice(parent), hDevice(INVALID_HANDLE_VALUE), m_fileSize(0), m_sectorSize(512)
 {
     hDevice = CreateFile(drivePath.toStdWString().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
     if (hDevice == INVALID_HANDLE_VALUE) {
@@ -15,13 +18,14 @@ WindowsDriveDevice::WindowsDriveDevice(const QString &drivePath, QObject *parent
     DWORD bytesReturned;
     if (DeviceIoControl(hDevice, IOCTL_DISK_GET_DRIVE_GEOMETRY_EX, NULL, 0, &diskGeometry, sizeof(diskGeometry), &bytesReturned, NULL)) {
         m_fileSize = diskGeometry.DiskSize.QuadPart;
+        if (diskGeometry.Geometry.BytesPerSector > 0) {
+            m_sectorSize = diskGeometry.Geometry.BytesPerSector;
+        }
     } else {
         qCritical() << "Failed to get physical drive size.";
         CloseHandle(hDevice);
         hDevice = INVALID_HANDLE_VALUE;
     }
-
-    buffer.resize(1024); // Set buffer size to 1024 bytes
 }
 
 qint64 WindowsDriveDevice::size() const
@@ -29,6 +33,16 @@ qint64 WindowsDriveDevice::size() const
     return m_fileSize;
 }
 
+qint64 WindowsDriveDevice::mediaSize() const
+{
+    return m_fileSize;
+}
+
+qint64 WindowsDriveDevice::sectorSize() const
+{
+    return m_sectorSize;
+}
+
 WindowsDriveDevice::~WindowsDriveDevice()
 {
     if (hDevice != INVALID_HANDLE_VALUE) {
@@ -38,61 +52,46 @@ WindowsDriveDevice::~WindowsDriveDevice()
 
 qint64 WindowsDriveDevice::readData(char *data, qint64 maxlen)
 {
-    qint64 pos = QIODevice::pos(); // Get the current position
-    qint64 bytesRead = 0;
-
-    //qDebug() << "Reading " << maxlen << " bytes from position " << pos;
-
-    while (maxlen > 0) {
-        // If the position is outside the current buffer, refill the buffer
-        if (pos < bufferStartPos || pos >= bufferEndPos) {
-            if (!fillBuffer(pos)) {
-                break; // If buffer fill fails, break the loop
-            }
-        }
-
-        // Calculate how many bytes can be read from the current buffer
-        qint64 bufferOffset = pos - bufferStartPos;
-        qint64 bytesToRead = qMin(maxlen, bufferEndPos - pos);
+    return readAt(QIODevice::pos(), data, maxlen);
+}
 
-        if (bytesToRead <= 0) break; // Prevent infinite loop if bytesToRead is not positive
+qint64 WindowsDriveDevice::readAt(qint64 offset, char *data, qint64 maxlen)
+{
+    const qint64 sectorSize = m_sectorSize;
 
-        memcpy(data + bytesRead, buffer.constData() + bufferOffset, bytesToRead);
-        bytesRead += bytesToRead;
-        maxlen -= bytesToRead;
+    if (offset < 0 || maxlen < 0 || hDevice == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    if (maxlen == 0 || offset >= m_fileSize) {
+        return 0;
     }
 
-    //qDebug() << "Read " << bytesRead << " bytes from position " << pos;
-
-    return bytesRead;
-}
-
-bool WindowsDriveDevice::fillBuffer(qint64 position)
-{
-    qint64 alignedPosition = (position / 512) * 512;
+    // Physical drives only accept whole sectors, read the covering aligned range
+    qint64 bytesToRead = qMin(maxlen, m_fileSize - offset);
+    qint64 alignedStart = (offset / sectorSize) * sectorSize;
+    qint64 alignedEnd = ((offset + bytesToRead + sectorSize - 1) / sectorSize) * sectorSize;
 
-    qDebug() << "filling Buffer  from " << position;
+    QByteArray sectors(alignedEnd - alignedStart, Qt::Uninitialized);
+    IoStatistics::ReadTimer timer(m_statistics);
 
+    // The offset travels with the request so the shared file pointer is never used
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(alignedStart & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(alignedStart >> 32);
 
-    LARGE_INTEGER li;
-    li.QuadPart = alignedPosition;
-    if (!SetFilePointerEx(hDevice, li, NULL, FILE_BEGIN)) {
-        qCritical() << "Failed to seek to position" << alignedPosition;
-        return false;
+    DWORD sectorBytesRead = 0;
+    if (!ReadFile(hDevice, sectors.data(), static_cast<DWORD>(sectors.size()), &sectorBytesRead, &overlapped)) {
+        qCritical() << "Failed to read from the drive at position" << alignedStart;
+        return timer.finish(-1);
     }
 
-    DWORD bytesRead;
-    if (!ReadFile(hDevice, buffer.data(), buffer.size(), &bytesRead, NULL) || bytesRead == 0) {
-        qCritical() << "Failed to read from the drive at position" << alignedPosition;
-        return false;
+    qint64 available = qMin(bytesToRead, static_cast<qint64>(sectorBytesRead) - (offset - alignedStart));
+    if (available <= 0) {
+        return timer.finish(0);
     }
 
-    bufferStartPos = alignedPosition;
-    bufferEndPos = bufferStartPos + bytesRead;
-
-    //qDebug() << "Buffer filled from " << bufferStartPos << " to " << bufferEndPos;
-
-    return true;
+    memcpy(data, sectors.constData() + (offset - alignedStart), available);
+    return timer.finish(available);
 }
 
 qint64 WindowsDriveDevice::writeData(const char *data, qint64 len)
@@ -102,3 +101,5 @@ qint64 WindowsDriveDevice::writeData(const char *data, qint64 len)
     Q_UNUSED(len);
     return -1;
 }
+
+#endif // Q_OS_WIN